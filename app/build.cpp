@@ -18,6 +18,7 @@
 #include <entwine/builder/builder.hpp>
 #include <entwine/builder/thread-pools.hpp>
 #include <entwine/io/io.hpp>
+#include <entwine/io/scheduler.hpp>
 #include <entwine/types/bounds.hpp>
 #include <entwine/types/files.hpp>
 #include <entwine/types/metadata.hpp>
@@ -58,6 +59,13 @@ void Build::addArgs()
             "Example: --threads 12",
             [this](Json::Value v) { m_json["threads"] = parse(v.asString()); });
 
+    m_ap.add(
+            "--ioConcurrency",
+            "Maximum number of concurrent storage requests per endpoint.  "
+            "Default: unlimited.\n"
+            "Example: --ioConcurrency 32",
+            [this](Json::Value v) { m_json["ioConcurrency"] = extract(v); });
+
     m_ap.add(
             "--force",
             "-f",
@@ -68,10 +76,25 @@ void Build::addArgs()
     m_ap.add(
             "--dataType",
             "Data type for serialized point cloud data.  Valid values are "
-            "\"laszip\" or \"binary\".  Default: \"laszip\".\n"
+            "\"laszip\", \"binary\", \"zstandard\", \"columnar\", or "
+            "\"spatial\".  "
+            "Default: \"laszip\".\n"
             "Example: --dataType binary",
             [this](Json::Value v) { m_json["dataType"] = v.asString(); });
 
+    m_ap.add(
+            "--dataOptions",
+            "Options for the selected data type, as a JSON object.  For "
+            "\"zstandard\", a compression \"level\" may be set, and a "
+            "compression dictionary trained by setting \"dictionary\".  "
+            "For any type, setting \"pack\" packs nodes into shared "
+            "archive files.\n"
+            "Example: --dataOptions '{ \"level\": 5, \"dictionary\": true }'",
+            [this](Json::Value v)
+            {
+                m_json["dataOptions"] = parse(v.asString());
+            });
+
     m_ap.add(
             "--ticks",
             "Number of voxels in each spatial dimension for data nodes.  "
@@ -204,6 +227,20 @@ void Build::run()
 
     std::cout << "Save complete.\n";
 
+    const Json::Value io(IoScheduler::instance().toJson());
+    for (const std::string& root : io.getMemberNames())
+    {
+        const Json::Value& s(io[root]);
+        std::cout <<
+            "\tI/O " << root << ": " <<
+            commify(s["requests"].asUInt64()) << " requests, " <<
+            commify(s["failures"].asUInt64()) << " failed, " <<
+            commify(s["coalesced"].asUInt64()) << " coalesced, " <<
+            commify(s["bytesRead"].asUInt64()) << " bytes read, " <<
+            commify(s["bytesWritten"].asUInt64()) << " bytes written" <<
+            std::endl;
+    }
+
     const PointStats stats(files.pointStats());
 
     if (alreadyInserted)
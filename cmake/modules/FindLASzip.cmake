@@ -0,0 +1,11 @@
+include(FindPackageHandleStandardArgs)
+
+find_path(LASZIP_INCLUDE_DIR NAMES laszip/laszip_api.h)
+find_library(LASZIP_LIBRARY NAMES laszip laszip3)
+
+find_package_handle_standard_args(LASzip LASZIP_INCLUDE_DIR LASZIP_LIBRARY)
+
+if (LASZIP_FOUND)
+    set(LASZIP_LIBRARIES ${LASZIP_LIBRARY})
+    set(LASZIP_INCLUDE_DIRS ${LASZIP_INCLUDE_DIR})
+endif()
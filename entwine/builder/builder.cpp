@@ -21,6 +21,7 @@
 #include <entwine/builder/registry.hpp>
 #include <entwine/builder/sequence.hpp>
 #include <entwine/builder/thread-pools.hpp>
+#include <entwine/io/scheduler.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/types/bounds.hpp>
 #include <entwine/types/file-info.hpp>
@@ -76,6 +77,11 @@ Builder::Builder(const Config& config, std::shared_ptr<arbiter::Arbiter> a)
     , m_reset(now())
     , m_resetFiles(m_config["resetFiles"].asUInt64())
 {
+    if (const std::size_t n = m_config.ioConcurrency())
+    {
+        IoScheduler::instance().setConcurrency(n);
+    }
+
     prepareEndpoints();
 }
 
@@ -236,42 +242,6 @@ void Builder::doRun(const std::size_t max)
 void Builder::insertPath(const Origin originId, FileInfo& info)
 {
     const std::string rawPath(info.path());
-    std::size_t tries(0);
-    std::unique_ptr<arbiter::fs::LocalHandle> localHandle;
-
-    do
-    {
-        if (tries) std::this_thread::sleep_for(std::chrono::seconds(tries));
-
-        try
-        {
-            localHandle = m_arbiter->getLocalHandle(rawPath, *m_tmp);
-        }
-        catch (const std::exception& e)
-        {
-            if (verbose())
-            {
-                std::cout <<
-                    "Failed GET " << tries << " of " << rawPath << ": " <<
-                    e.what() << std::endl;
-            }
-        }
-        catch (...)
-        {
-            if (verbose())
-            {
-                std::cout <<
-                    "Failed GET " << tries << " of " << rawPath << ": " <<
-                    "unknown error" << std::endl;
-            }
-        }
-    }
-    while (!localHandle && ++tries < inputRetryLimit);
-
-    if (!localHandle) throw std::runtime_error("No local handle: " + rawPath);
-
-    const std::string& localPath(localHandle->localPath());
-
     uint64_t inserted(0);
     uint64_t pointId(0);
 
@@ -327,7 +297,49 @@ void Builder::insertPath(const Origin originId, FileInfo& info)
         }
     });
 
-    const Json::Value pipeline(m_config.pipeline(localPath));
+    // Remote LAS and LAZ files are streamed with ranged reads if possible,
+    // rather than downloading them before reading.
+    if (m_arbiter->isRemote(rawPath))
+    {
+        const Json::Value pipeline(m_config.pipeline(rawPath));
+        if (Executor::get().stream(table, pipeline, *m_arbiter)) return;
+    }
+
+    std::size_t tries(0);
+    std::unique_ptr<arbiter::fs::LocalHandle> localHandle;
+
+    do
+    {
+        if (tries) std::this_thread::sleep_for(std::chrono::seconds(tries));
+
+        try
+        {
+            localHandle = m_arbiter->getLocalHandle(rawPath, *m_tmp);
+        }
+        catch (const std::exception& e)
+        {
+            if (verbose())
+            {
+                std::cout <<
+                    "Failed GET " << tries << " of " << rawPath << ": " <<
+                    e.what() << std::endl;
+            }
+        }
+        catch (...)
+        {
+            if (verbose())
+            {
+                std::cout <<
+                    "Failed GET " << tries << " of " << rawPath << ": " <<
+                    "unknown error" << std::endl;
+            }
+        }
+    }
+    while (!localHandle && ++tries < inputRetryLimit);
+
+    if (!localHandle) throw std::runtime_error("No local handle: " + rawPath);
+
+    const Json::Value pipeline(m_config.pipeline(localHandle->localPath()));
 
     if (!Executor::get().run(table, pipeline))
     {
@@ -366,7 +378,9 @@ void Builder::save(const arbiter::Endpoint& ep)
     }
 
     if (verbose()) std::cout << "Saving registry..." << std::endl;
-    m_registry->save();
+    // A continued build of an index without node statistics gains them
+    // only once every hierarchy page has been rewritten with them.
+    if (m_registry->save()) m_metadata->m_nodeStats = true;
 
     if (verbose()) std::cout << "Saving metadata..." << std::endl;
     m_metadata->save(*m_out, m_config);
@@ -134,6 +134,9 @@ void ReffedChunk::unref(const Origin o)
                     m_chunk->overflowBlock());
 
             m_hierarchy.set(m_key.get(), table.size());
+            m_hierarchy.setStats(
+                    m_key.get(),
+                    NodeStats(m_metadata.schema(), table.refs()));
 
             m_metadata.dataIo().write(
                     m_out,
@@ -13,6 +13,7 @@
 #include <entwine/builder/scan.hpp>
 #include <entwine/io/ensure.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/types/files.hpp>
 
 namespace entwine
 {
@@ -94,15 +95,28 @@ Config Config::prepare() const
                     from.end(),
                     [](Json::Value j) { return !j.isObject(); }))
     {
-        // TODO If this is a continued build with files added, we shouldn't be
-        // re-scanning everything.  This should be filtered by only the entries
-        // which are not objects and then the result intelligently merged.
+        // If this is a continued build with files added, we only need to scan
+        // the new files - the existing ones are already described by the
+        // output, which is merged over this configuration by the builder.
+        if (isContinuation())
+        {
+            from = unindexed(from);
+
+            if (from.empty())
+            {
+                Json::Value result(json());
+                result.removeMember("input");
+                return result;
+            }
+        }
+
         if (verbose()) std::cout << "Scanning input" << std::endl;
 
         // Remove the output from the Scan config - this path is the output
         // path for the subsequent 'build' step.
         Json::Value scanConfig(json());
         scanConfig.removeMember("output");
+        scanConfig["input"] = from;
         scan = Scan(scanConfig).go().json();
     }
 
@@ -203,6 +217,28 @@ FileInfoList Config::input() const
     return f;
 }
 
+Json::Value Config::unindexed(const Json::Value& input) const
+{
+    arbiter::Arbiter a(m_json["arbiter"]);
+    const Files existing(
+            Files::extract(a.getEndpoint(output()), false, postfix()));
+
+    Json::Value result(Json::arrayValue);
+
+    for (const Json::Value& j : input)
+    {
+        Json::Value c(m_json);
+        c["input"] = j;
+
+        for (const FileInfo& f : existing.diff(Config(c).input()))
+        {
+            result.append(j.isObject() ? j : Json::Value(f.path()));
+        }
+    }
+
+    return result;
+}
+
 Json::Value Config::pipeline(std::string filename) const
 {
     const auto r(reprojection());
@@ -142,6 +142,11 @@ public:
                         "ept" + postfix() + ".json"));
     }
 
+    std::size_t ioConcurrency() const
+    {
+        return m_json["ioConcurrency"].asUInt64();
+    }
+
     bool verbose() const { return m_json["verbose"].asBool(); }
     bool force() const { return m_json["force"].asBool(); }
     bool trustHeaders() const { return m_json["trustHeaders"].asBool(); }
@@ -213,6 +218,10 @@ private:
 
     Config fromScan(std::string file) const;
 
+    // Filter the given input list to only those which do not already exist in
+    // the output of a continued build.
+    Json::Value unindexed(const Json::Value& input) const;
+
     Json::Value m_json;
 };
 
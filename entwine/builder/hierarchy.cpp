@@ -22,7 +22,15 @@ Hierarchy::Hierarchy(
         const arbiter::Endpoint& ep,
         const bool exists)
 {
-    if (exists) load(m, ep);
+    if (exists)
+    {
+        load(m, ep);
+
+        // Keep the existing paging so that appending to this hierarchy only
+        // needs to rewrite the pages which have been modified.
+        m_loaded = true;
+        m_step = m_loadedStep;
+    }
 }
 
 void Hierarchy::load(
@@ -38,24 +46,54 @@ void Hierarchy::load(
         assert(!m_map.count(k));
 
         int64_t n(json[s].asInt64());
-        if (n < 0) load(m, ep, k);
+        if (n < 0)
+        {
+            if (!m_loadedStep) m_loadedStep = k.d;
+            load(m, ep, k);
+        }
         else m_map[k] = static_cast<uint64_t>(n);
     }
+
+    // Indexes built before node statistics were recorded have none.
+    if (m.nodeStats())
+    {
+        const auto stats(parse(ep.get(statsFilename(m, root))));
+        for (const auto s : stats.getMemberNames())
+        {
+            m_stats[Dxyz(s)] = NodeStats(stats[s]);
+        }
+    }
 }
 
-void Hierarchy::save(
+bool Hierarchy::save(
         const Metadata& m,
         const arbiter::Endpoint& ep,
         Pool& pool) const
 {
+    // If we've continued an existing build without changing its paging, then
+    // only the pages containing modified nodes need to be written.
+    std::set<Dxyz> pages;
+    const bool partial(m_loaded && m_step == m_loadedStep);
+    if (partial) pages = dirtyPages();
+
     Json::Value json(Json::objectValue);
+    Json::Value statsJson(Json::objectValue);
     const ChunkKey k(m);
-    save(m, ep, pool, k, json);
+    save(m, ep, pool, k, json, statsJson, partial ? &pages : nullptr);
 
-    const std::string f(filename(m, k));
-    pool.add([&ep, f, json]() { ensurePut(ep, f, json.toStyledString()); });
+    if (!partial || pages.count(k.dxyz()))
+    {
+        const std::string f(filename(m, k));
+        const std::string sf(statsFilename(m, k.dxyz()));
+        pool.add([&ep, f, json]() { ensurePut(ep, f, json.toStyledString()); });
+        pool.add([&ep, sf, statsJson]()
+        {
+            ensurePut(ep, sf, toFastString(statsJson));
+        });
+    }
 
     pool.await();
+    return !partial;
 }
 
 void Hierarchy::save(
@@ -63,11 +101,16 @@ void Hierarchy::save(
         const arbiter::Endpoint& ep,
         Pool& pool,
         const ChunkKey& k,
-        Json::Value& curr) const
+        Json::Value& curr,
+        Json::Value& currStats,
+        const std::set<Dxyz>* pages) const
 {
     const uint64_t n(get(k.dxyz()));
     if (!n) return;
 
+    Json::Value nodeStats;
+    if (const NodeStats* s = stats(k.dxyz())) nodeStats = s->toJson();
+
     if (m_step && k.depth() && (k.depth() % m_step == 0))
     {
         curr[k.toString()] = -1;
@@ -75,23 +118,69 @@ void Hierarchy::save(
         Json::Value next;
         next[k.toString()] = static_cast<Json::UInt64>(n);
 
+        Json::Value nextStats(Json::objectValue);
+        if (!nodeStats.isNull()) nextStats[k.toString()] = nodeStats;
+
         for (uint64_t dir(0); dir < 8; ++dir)
         {
-            save(m, ep, pool, k.getStep(toDir(dir)), next);
+            save(m, ep, pool, k.getStep(toDir(dir)), next, nextStats, pages);
         }
 
-        const std::string f(filename(m, k));
-        pool.add([&ep, f, next]() { ensurePut(ep, f, toFastString(next)); });
+        if (!pages || pages->count(k.dxyz()))
+        {
+            const std::string f(filename(m, k));
+            const std::string sf(statsFilename(m, k.dxyz()));
+            pool.add([&ep, f, next]()
+            {
+                ensurePut(ep, f, toFastString(next));
+            });
+            pool.add([&ep, sf, nextStats]()
+            {
+                ensurePut(ep, sf, toFastString(nextStats));
+            });
+        }
     }
     else
     {
         curr[k.toString()] = static_cast<Json::UInt64>(n);
+        if (!nodeStats.isNull()) currStats[k.toString()] = nodeStats;
 
         for (uint64_t dir(0); dir < 8; ++dir)
         {
-            save(m, ep, pool, k.getStep(toDir(dir)), curr);
+            save(m, ep, pool, k.getStep(toDir(dir)), curr, currStats, pages);
+        }
+    }
+}
+
+Dxyz Hierarchy::pageOf(const Dxyz& k) const
+{
+    if (!m_step || k.d < m_step) return Dxyz();
+
+    const uint64_t d(k.d - k.d % m_step);
+    const uint64_t shift(k.d - d);
+    return Dxyz(d, k.p.x >> shift, k.p.y >> shift, k.p.z >> shift);
+}
+
+std::set<Dxyz> Hierarchy::dirtyPages() const
+{
+    std::set<Dxyz> pages;
+
+    for (const auto& p : m_dirty)
+    {
+        const Dxyz& k(p.first);
+        const bool created(p.second);
+
+        pages.insert(pageOf(k));
+
+        // A newly created page root must also be linked from its parent page.
+        if (created && m_step && k.d && k.d % m_step == 0)
+        {
+            pages.insert(
+                    pageOf(Dxyz(k.d - 1, k.p.x >> 1, k.p.y >> 1, k.p.z >> 1)));
         }
     }
+
+    return pages;
 }
 
 void Hierarchy::analyze(const Metadata& m, const bool verbose) const
@@ -16,6 +16,7 @@
 #include <entwine/builder/heuristics.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/types/key.hpp>
+#include <entwine/types/node-stats.hpp>
 #include <entwine/util/pool.hpp>
 #include <entwine/util/spin-lock.hpp>
 
@@ -47,8 +48,31 @@ public:
     {
         SpinGuard lock(m_spin);
         auto it(m_map.find(key));
-        if (it == m_map.end()) m_map[key] = val;
+        const bool created(it == m_map.end());
+        if (created) m_map[key] = val;
         else it->second = val;
+
+        // For a continued build, track the nodes that have been touched so we
+        // only rewrite the hierarchy pages containing them.
+        if (m_loaded)
+        {
+            auto& c(m_dirty[key]);
+            c = c || created;
+        }
+    }
+
+    void setStats(const Dxyz& key, NodeStats stats)
+    {
+        SpinGuard lock(m_spin);
+        m_stats[key] = std::move(stats);
+    }
+
+    // Returns null if no statistics were recorded for this node.
+    const NodeStats* stats(const Dxyz& key) const
+    {
+        SpinGuard lock(m_spin);
+        auto it(m_stats.find(key));
+        return it != m_stats.end() ? &it->second : nullptr;
     }
 
     uint64_t get(const Dxyz& key) const
@@ -71,7 +95,9 @@ public:
 
     const Map& map() const { return m_map; }
 
-    void save(
+    // Returns true if every page was written, along with its statistics,
+    // rather than only those modified since our hierarchy was loaded.
+    bool save(
             const Metadata& metadata,
             const arbiter::Endpoint& top,
             Pool& pool) const;
@@ -101,11 +127,25 @@ private:
 
     using AnalysisSet = std::set<Analysis>;
 
+    // Returns the root key of the hierarchy page containing this key.
+    Dxyz pageOf(const Dxyz& key) const;
+
+    // Returns the set of page roots which must be rewritten to reflect the
+    // modifications since our existing hierarchy was loaded.
+    std::set<Dxyz> dirtyPages() const;
+
     std::string filename(const Metadata& m, const Dxyz& dxyz) const
     {
         return dxyz.toString() + m.postfix() + ".json";
     }
 
+    // Node statistics are written alongside each hierarchy page, for the
+    // same nodes.
+    std::string statsFilename(const Metadata& m, const Dxyz& dxyz) const
+    {
+        return dxyz.toString() + m.postfix() + ".stats.json";
+    }
+
     std::string filename(const Metadata& m, const ChunkKey& k) const
     {
         return filename(m, k.dxyz());
@@ -121,7 +161,9 @@ private:
             const arbiter::Endpoint& endpoint,
             Pool& pool,
             const ChunkKey& key,
-            Json::Value& json) const;
+            Json::Value& json,
+            Json::Value& stats,
+            const std::set<Dxyz>* pages) const;
 
     void analyze(
             const Metadata& m,
@@ -132,7 +174,12 @@ private:
 
     mutable SpinLock m_spin;
     Map m_map;
+    std::map<Dxyz, NodeStats> m_stats;
     mutable uint64_t m_step = 0;
+
+    bool m_loaded = false;
+    uint64_t m_loadedStep = 0;
+    std::map<Dxyz, bool> m_dirty;
 };
 
 } // namespace entwine
@@ -41,9 +41,10 @@ Registry::Registry(
     , m_root(ChunkKey(metadata), m_dataEp, tmp, m_hierarchy)
 { }
 
-void Registry::save() const
+bool Registry::save() const
 {
-    m_hierarchy.save(m_metadata, m_hierEp, m_threadPools.workPool());
+    m_metadata.dataIo().save(m_dataEp, m_tmp);
+    return m_hierarchy.save(m_metadata, m_hierEp, m_threadPools.workPool());
 }
 
 void Registry::merge(const Registry& other, Clipper& clipper)
@@ -85,6 +86,10 @@ void Registry::merge(const Registry& other, Clipper& clipper)
         {
             assert(!m_hierarchy.get(dxyz));
             m_hierarchy.set(dxyz, np);
+            if (const NodeStats* s = other.hierarchy().stats(dxyz))
+            {
+                m_hierarchy.setStats(dxyz, *s);
+            }
         }
     }
 }
@@ -46,7 +46,8 @@ public:
             ThreadPools& threadPools,
             bool exists = false);
 
-    void save() const;
+    // Returns true if the hierarchy was written in full (see Hierarchy).
+    bool save() const;
     void merge(const Registry& other, Clipper& clipper);
 
     void addPoint(Voxel& voxel, Key& key, Clipper& clipper)
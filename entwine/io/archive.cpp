@@ -0,0 +1,411 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/io/archive.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+
+#include <entwine/io/ensure.hpp>
+#include <entwine/util/json.hpp>
+#include <entwine/util/unique.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    const uint64_t defaultStep(6);
+    const uint64_t defaultBytes(64 * 1024 * 1024);
+
+    std::string segmentName(const std::string& group, const uint64_t n)
+    {
+        return group + "-" + std::to_string(n) + ".pack";
+    }
+
+    std::string indexName(const std::string& group)
+    {
+        return group + ".pack.json";
+    }
+
+    // Parse the D-X-Y-Z key at the start of _name_, setting _pos_ to the
+    // position which follows it.
+    bool parseKey(const std::string& name, uint64_t (&v)[4], std::size_t& pos)
+    {
+        pos = 0;
+
+        for (std::size_t i(0); i < 4; ++i)
+        {
+            if (pos >= name.size() || !std::isdigit(name[pos])) return false;
+
+            std::size_t n(0);
+            v[i] = std::stoull(name.substr(pos), &n);
+            pos += n;
+
+            if (i < 3)
+            {
+                if (pos >= name.size() || name[pos] != '-') return false;
+                ++pos;
+            }
+        }
+
+        return true;
+    }
+
+    uint64_t depthOf(const std::string& group)
+    {
+        return std::stoull(group);
+    }
+}
+
+Archive::Archive(const Json::Value& json)
+    : m_step(json.isObject() && json.isMember("step") ?
+            json["step"].asUInt64() : defaultStep)
+    , m_bytes(json.isObject() && json.isMember("bytes") ?
+            json["bytes"].asUInt64() : defaultBytes)
+    , m_saved(json.isObject() && json["saved"].asBool())
+{
+    if (!m_step) throw std::runtime_error("Invalid packing step");
+    if (!m_bytes) throw std::runtime_error("Invalid packing size");
+}
+
+Archive::~Archive() { }
+
+Json::Value Archive::toJson() const
+{
+    Json::Value json;
+    json["step"] = static_cast<Json::UInt64>(m_step);
+    json["bytes"] = static_cast<Json::UInt64>(m_bytes);
+    if (m_saved) json["saved"] = true;
+    return json;
+}
+
+std::string Archive::groupOf(const std::string& filename) const
+{
+    // Node files are named D-X-Y-Z, followed by an optional postfix and
+    // extension.
+    uint64_t v[4];
+    std::size_t pos(0);
+    if (!parseKey(filename, v, pos)) return std::string();
+
+    const uint64_t depth(v[0] - v[0] % m_step);
+    const uint64_t shift(v[0] - depth);
+
+    return
+        std::to_string(depth) + "-" +
+        std::to_string(v[1] >> shift) + "-" +
+        std::to_string(v[2] >> shift) + "-" +
+        std::to_string(v[3] >> shift) +
+        filename.substr(pos, filename.find('.', pos) - pos);
+}
+
+std::string Archive::parentOf(const std::string& group) const
+{
+    uint64_t v[4];
+    std::size_t pos(0);
+    if (!parseKey(group, v, pos) || !v[0]) return std::string();
+
+    return
+        std::to_string(v[0] - m_step) + "-" +
+        std::to_string(v[1] >> m_step) + "-" +
+        std::to_string(v[2] >> m_step) + "-" +
+        std::to_string(v[3] >> m_step) +
+        group.substr(pos);
+}
+
+Archive::Group& Archive::group(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& g(m_groups[name]);
+    if (!g) g = makeUnique<Group>();
+    return *g;
+}
+
+void Archive::load(
+        const arbiter::Endpoint& out,
+        const std::string& name,
+        Group& g)
+{
+    if (g.loaded) return;
+    g.loaded = true;
+
+    if (!indexed(out, name)) return;
+
+    const auto data(ensureGet(out, indexName(name)));
+    const Json::Value json(parse(std::string(data->begin(), data->end())));
+    g.indexed = true;
+    g.segments = json["segments"].asUInt64();
+
+    for (const std::string& key : json["nodes"].getMemberNames())
+    {
+        const Json::Value& v(json["nodes"][key]);
+        g.nodes[key] = Location {
+            v[0].asUInt64(), v[1].asUInt64(), v[2].asUInt64() };
+    }
+
+    for (const Json::Value& child : json["children"])
+    {
+        g.children.insert(child.asString());
+    }
+}
+
+bool Archive::indexed(const arbiter::Endpoint& out, const std::string& name)
+{
+    const std::string parent(parentOf(name));
+    if (parent.empty()) return m_saved;
+
+    Group& p(group(parent));
+    std::lock_guard<std::mutex> lock(p.mutex);
+    load(out, parent, p);
+    return p.children.count(name);
+}
+
+void Archive::put(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        const std::string& filename,
+        const std::vector<char>& data)
+{
+    const std::string name(groupOf(filename));
+    if (name.empty()) return ensurePut(out, filename, data);
+
+    Group& g(group(name));
+    std::lock_guard<std::mutex> lock(g.mutex);
+    load(out, name, g);
+
+    // A rewritten node is appended again, leaving its previous data
+    // unreferenced until its segment is closed.
+    if (!g.open)
+    {
+        g.open = true;
+        g.openSize = 0;
+        ++g.segments;
+    }
+
+    const uint64_t segment(g.segments - 1);
+    const std::string path(localPath(out, tmp, segmentName(name, segment)));
+
+    std::ofstream file(
+            path,
+            std::ios::out | std::ios::binary |
+                (g.openSize ? std::ios::app : std::ios::trunc));
+    file.write(data.data(), data.size());
+    file.close();
+
+    if (!file) throw std::runtime_error("Could not write " + path);
+
+    g.nodes[filename] = Location { segment, g.openSize, data.size() };
+    g.openSize += data.size();
+    g.dirty = true;
+
+    if (g.openSize >= m_bytes) close(out, tmp, name, g);
+}
+
+std::vector<char> Archive::get(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        const std::string& filename,
+        const uint64_t begin,
+        const uint64_t end)
+{
+    const auto direct([&]()
+    {
+        if (!begin && end == std::numeric_limits<uint64_t>::max())
+        {
+            return std::move(*ensureGet(out, filename));
+        }
+        return ensureGet(out, filename, begin, end);
+    });
+
+    const std::string name(groupOf(filename));
+    if (name.empty()) return direct();
+
+    Group& g(group(name));
+    std::unique_lock<std::mutex> lock(g.mutex);
+    load(out, name, g);
+
+    const auto it(g.nodes.find(filename));
+    if (it == g.nodes.end())
+    {
+        lock.unlock();
+        return direct();
+    }
+
+    const Location location(it->second);
+    const uint64_t from(location.offset + std::min(begin, location.size));
+    const uint64_t to(location.offset + std::min(end, location.size));
+    const std::string segment(segmentName(name, location.segment));
+
+    // The open segment is local, and may be uploaded once we release our
+    // lock, so read from it while we hold it.
+    if (g.open && location.segment == g.segments - 1)
+    {
+        const std::string path(localPath(out, tmp, segment));
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        file.seekg(from);
+
+        std::vector<char> data(to - from);
+        file.read(data.data(), data.size());
+        if (!file) throw std::runtime_error("Could not read " + path);
+        return data;
+    }
+
+    lock.unlock();
+
+    std::vector<char> data(ensureGet(out, segment, from, to));
+    if (data.size() != to - from)
+    {
+        throw std::runtime_error("Truncated archive segment: " + segment);
+    }
+    return data;
+}
+
+void Archive::close(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        const std::string& name,
+        Group& g)
+{
+    const std::string segment(segmentName(name, g.segments - 1));
+    const std::string path(localPath(out, tmp, segment));
+
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    const std::vector<char> data(
+            (std::istreambuf_iterator<char>(file)),
+            std::istreambuf_iterator<char>());
+    file.close();
+
+    // Drop the data of nodes which were rewritten while this segment was
+    // open, keeping the remaining nodes in their written order.
+    std::map<uint64_t, Location*> live;
+    for (auto& n : g.nodes)
+    {
+        Location& location(n.second);
+        if (location.segment == g.segments - 1)
+        {
+            live[location.offset] = &location;
+        }
+    }
+
+    std::vector<char> compacted;
+    compacted.reserve(data.size());
+
+    for (auto& p : live)
+    {
+        Location& location(*p.second);
+        if (location.offset + location.size > data.size())
+        {
+            throw std::runtime_error("Truncated archive segment: " + path);
+        }
+
+        const auto begin(data.begin() + location.offset);
+        location.offset = compacted.size();
+        compacted.insert(compacted.end(), begin, begin + location.size);
+    }
+
+    ensurePut(out, segment, compacted);
+    arbiter::fs::remove(path);
+
+    g.open = false;
+    g.openSize = 0;
+}
+
+void Archive::save(const arbiter::Endpoint& out, const arbiter::Endpoint& tmp)
+{
+    // Groups are saved from the deepest up, so that each new index is listed
+    // by its parent before the parent is saved.
+    using Queue = std::set<
+        std::pair<uint64_t, std::string>,
+        std::greater<std::pair<uint64_t, std::string>>>;
+
+    Queue queue;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& p : m_groups)
+        {
+            queue.emplace(depthOf(p.first), p.first);
+        }
+    }
+
+    // The root index is always written, so once saved, its existence can be
+    // relied upon.
+    if (!m_saved)
+    {
+        const std::string root("0-0-0-0");
+        Group& g(group(root));
+        std::lock_guard<std::mutex> lock(g.mutex);
+        load(out, root, g);
+        g.dirty = true;
+        queue.emplace(0, root);
+    }
+
+    for (const auto& entry : queue)
+    {
+        const std::string& name(entry.second);
+        Group& g(group(name));
+
+        std::lock_guard<std::mutex> groupLock(g.mutex);
+        if (g.open) close(out, tmp, name, g);
+        if (!g.dirty) continue;
+
+        const std::string parent(parentOf(name));
+        if (!g.indexed && !parent.empty())
+        {
+            Group& p(group(parent));
+            std::lock_guard<std::mutex> parentLock(p.mutex);
+            load(out, parent, p);
+
+            if (p.children.insert(name).second)
+            {
+                p.dirty = true;
+                queue.emplace(depthOf(parent), parent);
+            }
+        }
+
+        Json::Value json;
+        json["segments"] = static_cast<Json::UInt64>(g.segments);
+
+        Json::Value& nodes(json["nodes"]);
+        nodes = Json::objectValue;
+        for (const auto& n : g.nodes)
+        {
+            Json::Value& v(nodes[n.first]);
+            v.append(static_cast<Json::UInt64>(n.second.segment));
+            v.append(static_cast<Json::UInt64>(n.second.offset));
+            v.append(static_cast<Json::UInt64>(n.second.size));
+        }
+
+        Json::Value& children(json["children"]);
+        children = Json::arrayValue;
+        for (const std::string& c : g.children) children.append(c);
+
+        ensurePut(out, indexName(name), toFastString(json));
+        g.indexed = true;
+        g.dirty = false;
+    }
+
+    m_saved = true;
+}
+
+std::string Archive::localPath(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        const std::string& segment) const
+{
+    return tmp.prefixedRoot() +
+        arbiter::crypto::encodeAsHex(out.prefixedRoot() + segment);
+}
+
+} // namespace entwine
@@ -0,0 +1,129 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+
+namespace entwine
+{
+
+// Packs node files into shared archive objects rather than storing each node
+// as its own file.  Nodes are grouped by their ancestor at the nearest depth
+// which is a multiple of the packing step, and each group is appended into
+// segments of roughly a fixed size as its nodes are written.  Segments are
+// staged in the temporary directory and uploaded once full, so only the open
+// segment of each group is ever held locally.
+//
+// Each group has an index, named <group>.pack.json, mapping its node files to
+// their byte ranges within its segments, named <group>-<n>.pack.  Files which
+// are not in an index are read directly, so unpacked nodes remain readable.
+//
+// Each index also lists the groups beneath it, one step deeper, which have
+// indexes of their own, and the index of the root group is written by the
+// first save.  So whether an index exists is always known before it is
+// fetched, and a failure to fetch one is retried rather than mistaken for
+// its absence.
+//
+// A node which is rewritten while its segment is open is appended again, and
+// its previous data is dropped when the segment is closed.  Data left behind
+// in segments which were already closed is not reclaimed.
+class Archive
+{
+public:
+    Archive(const Json::Value& json);
+    ~Archive();
+
+    Json::Value toJson() const;
+
+    void put(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            const std::string& filename,
+            const std::vector<char>& data);
+
+    // Get the range [begin, end) of a node file.
+    std::vector<char> get(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            const std::string& filename,
+            uint64_t begin = 0,
+            uint64_t end = std::numeric_limits<uint64_t>::max());
+
+    // Upload any open segments and write the indexes of modified groups.
+    void save(const arbiter::Endpoint& out, const arbiter::Endpoint& tmp);
+
+private:
+    struct Location
+    {
+        uint64_t segment;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    struct Group
+    {
+        std::mutex mutex;
+        bool loaded = false;
+        bool indexed = false;
+        bool dirty = false;
+        bool open = false;
+        uint64_t segments = 0;
+        uint64_t openSize = 0;
+        std::map<std::string, Location> nodes;
+        std::set<std::string> children;
+    };
+
+    // Returns an empty string for files which are not node files.
+    std::string groupOf(const std::string& filename) const;
+
+    // Returns an empty string for the root group.
+    std::string parentOf(const std::string& group) const;
+
+    Group& group(const std::string& name);
+
+    // These are called with the lock of the group _name_ held, and may lock
+    // the groups above it.
+    void load(const arbiter::Endpoint& out, const std::string& name, Group& g);
+    bool indexed(const arbiter::Endpoint& out, const std::string& name);
+    void close(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            const std::string& name,
+            Group& g);
+
+    std::string localPath(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            const std::string& segment) const;
+
+    const uint64_t m_step;
+    const uint64_t m_bytes;
+
+    // True once the root index has been written.
+    std::atomic_bool m_saved;
+
+    std::mutex m_mutex;
+    std::map<std::string, std::unique_ptr<Group>> m_groups;
+};
+
+} // namespace entwine
@@ -12,11 +12,7 @@
 
 #include <algorithm>
 
-#include <pdal/PointRef.hpp>
-
 #include <entwine/types/binary-point-table.hpp>
-#include <entwine/types/scale-offset.hpp>
-#include <entwine/util/executor.hpp>
 
 namespace entwine
 {
@@ -28,57 +24,7 @@ void Binary::write(
         const Bounds& bounds,
         BlockPointTable& src) const
 {
-    const uint64_t np(src.size());
-
-    const Schema& outSchema(m_metadata.outSchema());
-    VectorPointTable dst(outSchema, np);
-
-    // Handle XYZ separately since we might need to scale/offset them.
-    pdal::DimTypeList dimTypes(outSchema.pdalLayout().dimTypes());
-    dimTypes.erase(std::remove_if(
-                dimTypes.begin(),
-                dimTypes.end(),
-                [](const pdal::DimType& d)
-                {
-                    return d.m_id == DimId::X || d.m_id == DimId::Y ||
-                        d.m_id == DimId::Z;
-                }));
-
-    pdal::PointRef srcPr(src, 0);
-    pdal::PointRef dstPr(dst, 0);
-
-    Point p;
-
-    std::unique_ptr<ScaleOffset> so(outSchema.scaleOffset());
-
-    for (uint64_t i(0); i < np; ++i)
-    {
-        srcPr.setPointId(i);
-        dstPr.setPointId(i);
-        char* pos(dst.getPoint(i));
-
-        // Handle XYZ, applying transformation if needed.
-        p.x = srcPr.getFieldAs<double>(DimId::X);
-        p.y = srcPr.getFieldAs<double>(DimId::Y);
-        p.z = srcPr.getFieldAs<double>(DimId::Z);
-
-        if (so) p = Point::scale(p, so->scale(), so->offset()).round();
-
-        dstPr.setField(DimId::X, p.x);
-        dstPr.setField(DimId::Y, p.y);
-        dstPr.setField(DimId::Z, p.z);
-
-        // Handle the rest of the dimensions.
-        for (const pdal::DimType& dim : dimTypes)
-        {
-            srcPr.getField(
-                    pos + outSchema.pdalLayout().dimOffset(dim.m_id),
-                    dim.m_id,
-                    dim.m_type);
-        }
-    }
-
-    ensurePut(out, filename + ".bin", dst.data());
+    store(out, tmp, filename + ".bin", pack(src));
 }
 
 void Binary::read(
@@ -87,56 +33,55 @@ void Binary::read(
         const std::string& filename,
         VectorPointTable& dst) const
 {
-    VectorPointTable src(
-            m_metadata.outSchema(),
-            std::move(*ensureGet(out, filename + ".bin")));
-    const uint64_t np(src.capacity());
-    assert(np == table.capacity());
-
-    // For reading, our destination schema will always be normalized (i.e. XYZ
-    // as doubles).  So we can just copy the full dimension list and then
-    // transform XYZ in place, if necessary.
-    const auto& layout(m_metadata.schema().pdalLayout());
-    pdal::DimTypeList dimTypes(layout.dimTypes());
+    unpack(fetch(out, tmp, filename + ".bin"), dst);
+}
 
-    pdal::PointRef srcPr(src, 0);
-    pdal::PointRef dstPr(dst, 0);
+std::vector<char> Binary::pack(BlockPointTable& src) const
+{
+    std::vector<char> dst(src.size() * m_pack.dstPointSize());
+    m_pack.apply(src.refs().data(), dst.data(), src.size());
+    return dst;
+}
 
-    Point p;
+void Binary::unpack(const std::vector<char>& src, VectorPointTable& dst) const
+{
+    const uint64_t pointSize(m_metadata.outSchema().pointSize());
+    if (src.size() % pointSize)
+    {
+        throw std::runtime_error("Invalid binary data size");
+    }
 
-    const Schema& outSchema(m_metadata.outSchema());
-    std::unique_ptr<ScaleOffset> so(outSchema.scaleOffset());
+    const uint64_t np(src.size() / pointSize);
 
-    for (uint64_t i(0); i < np; ++i)
+    for (uint64_t offset(0); offset < np; offset += dst.capacity())
     {
-        srcPr.setPointId(i);
-        dstPr.setPointId(i);
-        char* pos(dst.getPoint(i));
-
-        for (const pdal::DimType& dim : dimTypes)
-        {
-            srcPr.getField(
-                    pos + layout.dimOffset(dim.m_id),
-                    dim.m_id,
-                    dim.m_type);
-        }
+        const uint64_t n(std::min<uint64_t>(dst.capacity(), np - offset));
+        m_unpack.apply(src.data() + offset * pointSize, dst.getPoint(0), n);
+        dst.clear(n);
+    }
+}
 
-        if (so)
-        {
-            p.x = dstPr.getFieldAs<double>(DimId::X);
-            p.y = dstPr.getFieldAs<double>(DimId::Y);
-            p.z = dstPr.getFieldAs<double>(DimId::Z);
+void Binary::unpack(const char* src, char* dst, const uint64_t np) const
+{
+    // The source may overlap the destination, so copy out each batch before
+    // writing its unpacked form.  Since unpacked points are at least as large
+    // as packed ones, this never overwrites source data which is yet to be
+    // copied out.
+    const std::size_t srcPointSize(m_unpack.srcPointSize());
+    const std::size_t dstPointSize(m_unpack.dstPointSize());
+    const uint64_t batchSize(256);
 
-            p = Point::unscale(p, so->scale(), so->offset());
+    std::vector<char> batch(batchSize * srcPointSize);
 
-            dstPr.setField(DimId::X, p.x);
-            dstPr.setField(DimId::Y, p.y);
-            dstPr.setField(DimId::Z, p.z);
-        }
+    for (uint64_t offset(0); offset < np; offset += batchSize)
+    {
+        const uint64_t n(std::min(batchSize, np - offset));
+        std::copy(
+                src + offset * srcPointSize,
+                src + (offset + n) * srcPointSize,
+                batch.data());
+        m_unpack.apply(batch.data(), dst + offset * dstPointSize, n);
     }
-
-    dst.clear(np);
 }
 
 } // namespace entwine
-
@@ -10,9 +10,12 @@
 
 #pragma once
 
+#include <vector>
+
 #include <entwine/io/io.hpp>
 
 #include <entwine/types/binary-point-table.hpp>
+#include <entwine/types/copy-plan.hpp>
 
 namespace entwine
 {
@@ -20,9 +23,14 @@ namespace entwine
 class Binary : public DataIo
 {
 public:
-    Binary(const Metadata& m) : DataIo(m) { }
+    Binary(const Metadata& m)
+        : DataIo(m)
+        , m_pack(m.schema(), m.outSchema())
+        , m_unpack(m.outSchema(), m.schema())
+    { }
 
     virtual std::string type() const override { return "binary"; }
+    virtual std::string extension() const override { return ".bin"; }
 
     virtual void write(
             const arbiter::Endpoint& out,
@@ -36,6 +44,24 @@ public:
             const arbiter::Endpoint& tmp,
             const std::string& filename,
             VectorPointTable& table) const override;
+
+protected:
+    // Pack the points of _src_ into the native layout of the output schema,
+    // applying its scale and offset to XYZ if necessary.
+    std::vector<char> pack(BlockPointTable& src) const;
+
+    // Unpack output-schema-formatted data into _dst_ in batches of its
+    // capacity, invoking its process callback after each batch.
+    void unpack(const std::vector<char>& src, VectorPointTable& dst) const;
+
+    // Unpack _np_ points in the output layout at _src_ to the normalized
+    // layout at _dst_.  The source may occupy the tail end of the destination
+    // region, so points may be unpacked in place.
+    void unpack(const char* src, char* dst, uint64_t np) const;
+
+private:
+    const CopyPlan m_pack;
+    const CopyPlan m_unpack;
 };
 
 } // namespace entwine
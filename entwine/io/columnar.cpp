@@ -0,0 +1,743 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/io/columnar.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef ENTWINE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <entwine/types/copy-plan.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+
+// File layout:
+//      magic               4 bytes, "ECOL"
+//      version             uint32
+//      number of points    uint64
+//      directory size      uint32
+//      directory           per column: uint8 name length, name, uint8 codec,
+//                          uint64 encoded size
+//      columns             encoded column data, in directory order
+const std::string magic("ECOL");
+const uint32_t version(1);
+const std::size_t fixedSize(20);
+
+// Large enough to capture the directory, and typically some column data, of
+// most nodes with a single request.
+const uint64_t prefixSize(4096);
+
+enum Codec : uint8_t
+{
+    Raw = 0,
+    Rle = 1,
+    Delta = 2,
+    BitPack = 3
+};
+
+// Values per bit-packed block, each of which is prefixed by its bit width.
+const uint64_t bitPackBlockSize(128);
+
+const uint8_t zstdFlag(0x80);
+const int zstdLevel(3);
+
+struct Column
+{
+    std::string name;
+    uint8_t codec;
+    uint64_t begin;
+    uint64_t size;
+};
+
+template<typename T>
+void put(std::vector<char>& out, const T v)
+{
+    const char* pos(reinterpret_cast<const char*>(&v));
+    out.insert(out.end(), pos, pos + sizeof(T));
+}
+
+template<typename T>
+T get(const char*& pos, const char* end)
+{
+    if (pos + sizeof(T) > end)
+    {
+        throw std::runtime_error("Invalid columnar data");
+    }
+
+    T v;
+    std::memcpy(&v, pos, sizeof(T));
+    pos += sizeof(T);
+    return v;
+}
+
+void putVarint(std::vector<char>& out, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+uint64_t getVarint(const char*& pos, const char* end)
+{
+    uint64_t v(0);
+    for (std::size_t shift(0); shift < 64; shift += 7)
+    {
+        if (pos == end) break;
+
+        const uint8_t b(*pos++);
+        v |= static_cast<uint64_t>(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+
+    throw std::runtime_error("Invalid columnar varint");
+}
+
+// Load a little-endian integer of _size_ bytes, sign-extending if needed.
+uint64_t load(const char* pos, const std::size_t size, const bool isSigned)
+{
+    uint64_t v(0);
+    std::memcpy(&v, pos, size);
+
+    const std::size_t bits(size * 8);
+    if (isSigned && bits < 64 && ((v >> (bits - 1)) & 1)) v |= ~0ULL << bits;
+    return v;
+}
+
+bool isIntegral(const DimType type)
+{
+    return pdal::Dimension::base(type) != pdal::Dimension::BaseType::Floating;
+}
+
+bool isSigned(const DimType type)
+{
+    return pdal::Dimension::base(type) == pdal::Dimension::BaseType::Signed;
+}
+
+uint64_t zigzag(const int64_t d)
+{
+    return (static_cast<uint64_t>(d) << 1) ^ (d >> 63);
+}
+
+uint64_t unzigzag(const uint64_t z)
+{
+    return (z >> 1) ^ (~(z & 1) + 1);
+}
+
+std::vector<char> encodeRle(const std::vector<char>& column, std::size_t size)
+{
+    std::vector<char> out;
+    const uint64_t np(column.size() / size);
+
+    uint64_t i(0);
+    while (i < np)
+    {
+        const char* v(column.data() + i * size);
+
+        uint64_t run(1);
+        while (i + run < np && !std::memcmp(v, v + run * size, size)) ++run;
+
+        putVarint(out, run);
+        out.insert(out.end(), v, v + size);
+        i += run;
+    }
+
+    return out;
+}
+
+void decodeRle(
+        const char* pos,
+        const char* end,
+        const std::size_t size,
+        std::vector<char>& column)
+{
+    char* dst(column.data());
+    char* const dstEnd(column.data() + column.size());
+
+    while (dst < dstEnd)
+    {
+        const uint64_t run(getVarint(pos, end));
+        if (pos + size > end || run > uint64_t(dstEnd - dst) / size)
+        {
+            throw std::runtime_error("Invalid run-length encoded column");
+        }
+
+        for (uint64_t i(0); i < run; ++i, dst += size)
+        {
+            std::memcpy(dst, pos, size);
+        }
+        pos += size;
+    }
+}
+
+// Zigzag-encoded differences between consecutive integral values.
+std::vector<char> encodeDelta(
+        const std::vector<char>& column,
+        const DimType type)
+{
+    std::vector<char> out;
+    const std::size_t size(pdal::Dimension::size(type));
+    const bool s(isSigned(type));
+    const uint64_t np(column.size() / size);
+
+    uint64_t prev(0);
+    for (uint64_t i(0); i < np; ++i)
+    {
+        const uint64_t v(load(column.data() + i * size, size, s));
+        putVarint(out, zigzag(static_cast<int64_t>(v - prev)));
+        prev = v;
+    }
+
+    return out;
+}
+
+void decodeDelta(
+        const char* pos,
+        const char* end,
+        const DimType type,
+        std::vector<char>& column)
+{
+    const std::size_t size(pdal::Dimension::size(type));
+    const uint64_t np(column.size() / size);
+
+    uint64_t prev(0);
+    for (uint64_t i(0); i < np; ++i)
+    {
+        const uint64_t z(getVarint(pos, end));
+        prev += unzigzag(z);
+        std::memcpy(column.data() + i * size, &prev, size);
+    }
+}
+
+// Writes bits least-significant first, flushing whole bytes as they fill.
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<char>& out) : m_out(out) { }
+
+    void put(uint64_t v, unsigned width)
+    {
+        while (width)
+        {
+            const unsigned take(std::min(width, 32u));
+            m_acc |= (v & ((1ULL << take) - 1)) << m_bits;
+            m_bits += take;
+            width -= take;
+            v >>= take;
+
+            while (m_bits >= 8)
+            {
+                m_out.push_back(static_cast<char>(m_acc & 0xFF));
+                m_acc >>= 8;
+                m_bits -= 8;
+            }
+        }
+    }
+
+    void flush()
+    {
+        if (m_bits) m_out.push_back(static_cast<char>(m_acc & 0xFF));
+        m_acc = 0;
+        m_bits = 0;
+    }
+
+private:
+    std::vector<char>& m_out;
+    uint64_t m_acc = 0;
+    unsigned m_bits = 0;
+};
+
+class BitReader
+{
+public:
+    BitReader(const char*& pos, const char* end) : m_pos(pos), m_end(end) { }
+
+    uint64_t get(unsigned width)
+    {
+        uint64_t v(0);
+        unsigned done(0);
+
+        while (done < width)
+        {
+            const unsigned take(std::min(width - done, 32u));
+            while (m_bits < take)
+            {
+                if (m_pos == m_end)
+                {
+                    throw std::runtime_error("Invalid bit-packed column");
+                }
+
+                m_acc |= static_cast<uint64_t>(
+                        static_cast<uint8_t>(*m_pos++)) << m_bits;
+                m_bits += 8;
+            }
+
+            v |= (m_acc & ((1ULL << take) - 1)) << done;
+            m_acc >>= take;
+            m_bits -= take;
+            done += take;
+        }
+
+        return v;
+    }
+
+    // Discard any bits remaining in a partially consumed byte.
+    void align()
+    {
+        m_acc = 0;
+        m_bits = 0;
+    }
+
+private:
+    const char*& m_pos;
+    const char* const m_end;
+    uint64_t m_acc = 0;
+    unsigned m_bits = 0;
+};
+
+// Zigzag-encoded differences, as for Delta, bit-packed in blocks which each
+// use the minimal width for their largest value.  This suits columns whose
+// consecutive values are close together, for example spatially sorted XYZ.
+std::vector<char> encodeBitPack(
+        const std::vector<char>& column,
+        const DimType type)
+{
+    std::vector<char> out;
+    const std::size_t size(pdal::Dimension::size(type));
+    const bool s(isSigned(type));
+    const uint64_t np(column.size() / size);
+
+    std::vector<uint64_t> block(bitPackBlockSize);
+    BitWriter writer(out);
+
+    uint64_t prev(0);
+    for (uint64_t begin(0); begin < np; begin += bitPackBlockSize)
+    {
+        const uint64_t n(std::min(bitPackBlockSize, np - begin));
+
+        uint64_t all(0);
+        for (uint64_t i(0); i < n; ++i)
+        {
+            const uint64_t v(
+                    load(column.data() + (begin + i) * size, size, s));
+            block[i] = zigzag(static_cast<int64_t>(v - prev));
+            all |= block[i];
+            prev = v;
+        }
+
+        uint8_t width(0);
+        while (width < 64 && (all >> width)) ++width;
+
+        out.push_back(static_cast<char>(width));
+        for (uint64_t i(0); i < n; ++i) writer.put(block[i], width);
+        writer.flush();
+    }
+
+    return out;
+}
+
+void decodeBitPack(
+        const char* pos,
+        const char* end,
+        const DimType type,
+        std::vector<char>& column)
+{
+    const std::size_t size(pdal::Dimension::size(type));
+    const uint64_t np(column.size() / size);
+
+    BitReader reader(pos, end);
+
+    uint64_t prev(0);
+    for (uint64_t begin(0); begin < np; begin += bitPackBlockSize)
+    {
+        const uint64_t n(std::min(bitPackBlockSize, np - begin));
+        const uint8_t width(get<uint8_t>(pos, end));
+        if (width > 64) throw std::runtime_error("Invalid bit-packed column");
+
+        for (uint64_t i(0); i < n; ++i)
+        {
+            prev += unzigzag(reader.get(width));
+            std::memcpy(column.data() + (begin + i) * size, &prev, size);
+        }
+
+        reader.align();
+    }
+}
+
+std::vector<char> encode(
+        const std::vector<char>& column,
+        const DimType type,
+        uint8_t& codec)
+{
+    std::vector<char> best(column);
+    codec = Raw;
+
+    auto consider([&best, &codec](std::vector<char> encoded, Codec c)
+    {
+        if (encoded.size() < best.size())
+        {
+            best = std::move(encoded);
+            codec = c;
+        }
+    });
+
+    consider(encodeRle(column, pdal::Dimension::size(type)), Rle);
+    if (isIntegral(type))
+    {
+        consider(encodeDelta(column, type), Delta);
+        consider(encodeBitPack(column, type), BitPack);
+    }
+
+#ifdef ENTWINE_HAVE_ZSTD
+    std::vector<char> compressed(ZSTD_compressBound(best.size()));
+    const std::size_t size(
+            ZSTD_compress(
+                compressed.data(),
+                compressed.size(),
+                best.data(),
+                best.size(),
+                zstdLevel));
+
+    if (!ZSTD_isError(size) && size < best.size())
+    {
+        compressed.resize(size);
+        best = std::move(compressed);
+        codec |= zstdFlag;
+    }
+#endif
+
+    return best;
+}
+
+std::vector<char> decode(
+        const char* pos,
+        uint64_t size,
+        const uint8_t codec,
+        const DimType type,
+        const uint64_t np)
+{
+    std::vector<char> decompressed;
+
+    if (codec & zstdFlag)
+    {
+#ifdef ENTWINE_HAVE_ZSTD
+        const unsigned long long decompressedSize(
+                ZSTD_getFrameContentSize(pos, size));
+
+        if (decompressedSize == ZSTD_CONTENTSIZE_ERROR ||
+                decompressedSize == ZSTD_CONTENTSIZE_UNKNOWN)
+        {
+            throw std::runtime_error("Invalid compressed column");
+        }
+
+        // Columns are only encoded if that makes them smaller than their raw
+        // values, so check the frame against those before allocating for it.
+        if (decompressedSize > np * pdal::Dimension::size(type))
+        {
+            throw std::runtime_error("Invalid compressed column size");
+        }
+
+        decompressed.resize(decompressedSize);
+        const std::size_t result(
+                ZSTD_decompress(
+                    decompressed.data(),
+                    decompressed.size(),
+                    pos,
+                    size));
+
+        if (ZSTD_isError(result) || result != decompressed.size())
+        {
+            throw std::runtime_error("Invalid compressed column");
+        }
+
+        pos = decompressed.data();
+        size = decompressed.size();
+#else
+        throw std::runtime_error("Entwine was not built with Zstandard");
+#endif
+    }
+
+    const char* end(pos + size);
+    std::vector<char> column(np * pdal::Dimension::size(type));
+
+    switch (codec & ~zstdFlag)
+    {
+        case Raw:
+            if (size != column.size())
+            {
+                throw std::runtime_error("Invalid raw column");
+            }
+            std::copy(pos, end, column.data());
+            break;
+        case Rle:
+            decodeRle(pos, end, pdal::Dimension::size(type), column);
+            break;
+        case Delta:
+            decodeDelta(pos, end, type, column);
+            break;
+        case BitPack:
+            decodeBitPack(pos, end, type, column);
+            break;
+        default:
+            throw std::runtime_error("Invalid column codec");
+    }
+
+    return column;
+}
+
+} // unnamed namespace
+
+void Columnar::write(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        const std::string& filename,
+        const Bounds& bounds,
+        BlockPointTable& src) const
+{
+    const Schema& outSchema(m_metadata.outSchema());
+    const std::size_t pointSize(outSchema.pointSize());
+    std::vector<char> packed(pack(src));
+    const uint64_t np(src.size());
+    sort(packed, bounds);
+
+    std::vector<char> directory;
+    std::vector<char> data;
+    std::vector<char> column;
+
+    std::size_t pos(0);
+    for (const DimInfo& dim : outSchema.dims())
+    {
+        const std::size_t size(dim.size());
+
+        column.resize(np * size);
+        for (uint64_t i(0); i < np; ++i)
+        {
+            std::copy(
+                    packed.data() + i * pointSize + pos,
+                    packed.data() + i * pointSize + pos + size,
+                    column.data() + i * size);
+        }
+        pos += size;
+
+        uint8_t codec(Raw);
+        const std::vector<char> encoded(encode(column, dim.type(), codec));
+
+        const std::string name(dim.name());
+        if (name.size() > 255)
+        {
+            throw std::runtime_error("Dimension name too long: " + name);
+        }
+
+        put<uint8_t>(directory, name.size());
+        directory.insert(directory.end(), name.begin(), name.end());
+        put<uint8_t>(directory, codec);
+        put<uint64_t>(directory, encoded.size());
+
+        data.insert(data.end(), encoded.begin(), encoded.end());
+    }
+
+    std::vector<char> file(magic.begin(), magic.end());
+    put<uint32_t>(file, version);
+    put<uint64_t>(file, np);
+    put<uint32_t>(file, directory.size());
+    file.insert(file.end(), directory.begin(), directory.end());
+    file.insert(file.end(), data.begin(), data.end());
+
+    store(out, tmp, filename + ".col", file);
+}
+
+void Columnar::read(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        const std::string& filename,
+        VectorPointTable& dst) const
+{
+    std::set<std::string> dims;
+    for (const DimInfo& d : m_metadata.schema().dims()) dims.insert(d.name());
+
+    std::vector<char> data;
+    readDims(out, tmp, filename, dims, data);
+
+    const std::size_t pointSize(m_metadata.schema().pointSize());
+    const uint64_t np(data.size() / pointSize);
+
+    for (uint64_t offset(0); offset < np; offset += dst.capacity())
+    {
+        const uint64_t n(std::min<uint64_t>(dst.capacity(), np - offset));
+        std::copy(
+                data.data() + offset * pointSize,
+                data.data() + (offset + n) * pointSize,
+                dst.getPoint(0));
+        dst.clear(n);
+    }
+}
+
+void Columnar::readDims(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        const std::string& filename,
+        const std::set<std::string>& dims,
+        std::vector<char>& data) const
+{
+    const std::string path(filename + ".col");
+    const Schema& schema(m_metadata.schema());
+    const Schema& outSchema(m_metadata.outSchema());
+
+    std::vector<char> head(fetch(out, tmp, path, 0, prefixSize));
+
+    const char* pos(head.data());
+    const char* end(head.data() + head.size());
+
+    if (head.size() < fixedSize || !std::equal(magic.begin(), magic.end(), pos))
+    {
+        throw std::runtime_error("Invalid columnar data: " + filename);
+    }
+    pos += magic.size();
+
+    if (get<uint32_t>(pos, end) != version)
+    {
+        throw std::runtime_error("Unsupported columnar version: " + filename);
+    }
+
+    const uint64_t np(get<uint64_t>(pos, end));
+    const uint64_t directorySize(get<uint32_t>(pos, end));
+
+    if (head.size() < fixedSize + directorySize)
+    {
+        const std::vector<char> rest(
+                fetch(out, tmp, path, head.size(), fixedSize + directorySize));
+        head.insert(head.end(), rest.begin(), rest.end());
+
+        if (head.size() < fixedSize + directorySize)
+        {
+            throw std::runtime_error("Truncated columnar data: " + filename);
+        }
+    }
+
+    pos = head.data() + fixedSize;
+    end = pos + directorySize;
+
+    // Select the requested columns which are part of our schema.
+    std::vector<Column> columns;
+    std::set<std::string> selected;
+
+    uint64_t begin(fixedSize + directorySize);
+    while (pos < end)
+    {
+        Column c;
+        const uint8_t nameSize(get<uint8_t>(pos, end));
+        if (pos + nameSize > end)
+        {
+            throw std::runtime_error("Invalid columnar directory: " + filename);
+        }
+        c.name.assign(pos, nameSize);
+        pos += nameSize;
+        c.codec = get<uint8_t>(pos, end);
+        c.size = get<uint64_t>(pos, end);
+        c.begin = begin;
+        begin += c.size;
+
+        if (dims.count(c.name) &&
+                schema.contains(c.name) &&
+                outSchema.contains(c.name))
+        {
+            columns.push_back(c);
+            selected.insert(c.name);
+        }
+    }
+
+    if (data.empty()) data.resize(np * schema.pointSize(), 0);
+    else if (data.size() != np * schema.pointSize())
+    {
+        throw std::runtime_error("Invalid columnar destination size");
+    }
+
+    if (columns.empty() || !np) return;
+
+    // Decode the selected columns into the packed layout, fetching adjacent
+    // columns with a single request.
+    const std::size_t packedPointSize(outSchema.pointSize());
+    std::vector<char> packed(np * packedPointSize, 0);
+
+    std::vector<char> range;
+    uint64_t rangeBegin(0);
+    uint64_t rangeEnd(0);
+
+    for (std::size_t i(0); i < columns.size(); ++i)
+    {
+        const Column& c(columns[i]);
+
+        if (c.begin + c.size > rangeEnd)
+        {
+            rangeBegin = c.begin;
+            rangeEnd = c.begin + c.size;
+
+            for (
+                    std::size_t j(i + 1);
+                    j < columns.size() && columns[j].begin == rangeEnd;
+                    ++j)
+            {
+                rangeEnd += columns[j].size;
+            }
+
+            if (rangeEnd <= head.size())
+            {
+                range.assign(head.data() + rangeBegin, head.data() + rangeEnd);
+            }
+            else range = fetch(out, tmp, path, rangeBegin, rangeEnd);
+
+            if (range.size() != rangeEnd - rangeBegin)
+            {
+                throw std::runtime_error(
+                        "Truncated columnar data: " + filename);
+            }
+        }
+
+        const DimInfo& dim(outSchema.find(c.name));
+        const std::size_t size(dim.size());
+        const std::vector<char> column(
+                decode(
+                    range.data() + (c.begin - rangeBegin),
+                    c.size,
+                    c.codec,
+                    dim.type(),
+                    np));
+
+        std::size_t offset(0);
+        for (const DimInfo& d : outSchema.dims())
+        {
+            if (d.name() == c.name) break;
+            offset += d.size();
+        }
+
+        for (uint64_t p(0); p < np; ++p)
+        {
+            std::copy(
+                    column.data() + p * size,
+                    column.data() + (p + 1) * size,
+                    packed.data() + p * packedPointSize + offset);
+        }
+    }
+
+    const CopyPlan plan(outSchema, schema, selected);
+    plan.apply(packed.data(), data.data(), np);
+}
+
+} // namespace entwine
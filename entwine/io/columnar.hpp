@@ -0,0 +1,62 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <entwine/io/binary.hpp>
+
+namespace entwine
+{
+
+// Stores each dimension of the output schema as a separately compressed
+// column, preceded by a directory of the columns, so that readers may fetch
+// and decode only the dimensions they need.  Each column is run-length,
+// delta, or bit-packed delta encoded, whichever is smallest, and further
+// compressed with Zstandard if available.
+class Columnar : public Binary
+{
+public:
+    Columnar(const Metadata& m) : Binary(m) { }
+
+    virtual std::string type() const override { return "columnar"; }
+    virtual std::string extension() const override { return ".col"; }
+    virtual bool columnar() const override { return true; }
+
+    virtual void write(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            const std::string& filename,
+            const Bounds& bounds,
+            BlockPointTable& table) const override;
+
+    virtual void read(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            const std::string& filename,
+            VectorPointTable& table) const override;
+
+    virtual void readDims(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            const std::string& filename,
+            const std::set<std::string>& dims,
+            std::vector<char>& data) const override;
+
+protected:
+    // Reorder the packed points of a node before they are split into columns.
+    virtual void sort(std::vector<char>& packed, const Bounds& bounds) const
+    { }
+};
+
+} // namespace entwine
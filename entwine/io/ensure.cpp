@@ -10,37 +10,11 @@
 
 #include <entwine/io/ensure.hpp>
 
-#include <chrono>
-#include <iostream>
-#include <mutex>
-#include <thread>
+#include <algorithm>
+#include <fstream>
 
-namespace
-{
-    const std::size_t retries(40);
-    std::mutex mutex;
-
-    void sleep(std::size_t tried, std::string method, std::string path)
-    {
-        std::this_thread::sleep_for(std::chrono::seconds(tried));
-
-        std::lock_guard<std::mutex> lock(mutex);
-        std::cout <<
-            "\tFailed " << method << " attempt " << tried << ": " << path <<
-            std::endl;
-    }
-
-    void suicide(std::string method)
-    {
-        std::lock_guard<std::mutex> lock(mutex);
-        std::cout <<
-            "\tFailed to " << method << " data: persistent failure.\n" <<
-            "\tThis is a non-recoverable error." <<
-            std::endl;
-
-        throw std::runtime_error("Fatal error - could not " + method);
-    }
-}
+#include <entwine/io/scheduler.hpp>
+#include <entwine/util/unique.hpp>
 
 namespace entwine
 {
@@ -50,55 +24,103 @@ void ensurePut(
         const std::string& path,
         const std::vector<char>& data)
 {
-    bool done(false);
-    std::size_t tried(0);
-
-    while (!done)
-    {
-        try
-        {
-            endpoint.put(path, data);
-            done = true;
-        }
-        catch (...)
-        {
-            if (++tried < retries)
+    IoScheduler::instance().run(
+            endpoint.prefixedRoot(),
+            IoMethod::Put,
+            path,
+            [&](uint64_t& bytes)
             {
-                sleep(tried, "PUT", endpoint.prefixedRoot() + path);
-            }
-            else suicide("PUT");
-        }
-    }
+                endpoint.put(path, data);
+                bytes = data.size();
+                return true;
+            });
 }
 
 std::unique_ptr<std::vector<char>> ensureGet(
         const arbiter::Endpoint& endpoint,
         const std::string& path)
 {
-    std::unique_ptr<std::vector<char>> data;
+    const std::string root(endpoint.prefixedRoot());
+    IoScheduler& scheduler(IoScheduler::instance());
+
+    return makeUnique<std::vector<char>>(
+            scheduler.coalesce(root, path, "", [&]()
+            {
+                std::unique_ptr<std::vector<char>> data;
+
+                scheduler.run(root, IoMethod::Get, path, [&](uint64_t& bytes)
+                {
+                    data = endpoint.tryGetBinary(path);
+                    if (data) bytes = data->size();
+                    return !!data;
+                });
+
+                return std::move(*data);
+            }));
+}
+
+std::vector<char> ensureGet(
+        const arbiter::Endpoint& endpoint,
+        const std::string& path,
+        const uint64_t begin,
+        const uint64_t end)
+{
+    if (end <= begin) return std::vector<char>();
 
-    bool done(false);
-    std::size_t tried(0);
+    const std::string root(endpoint.prefixedRoot());
+    const std::string range(
+            "@" + std::to_string(begin) + "-" + std::to_string(end));
 
-    while (!done)
+    IoScheduler& scheduler(IoScheduler::instance());
+
+    return scheduler.coalesce(root, path, range, [&]()
     {
-        data = endpoint.tryGetBinary(path);
+        std::unique_ptr<std::vector<char>> data;
 
-        if (data)
-        {
-            done = true;
-        }
-        else
+        scheduler.run(root, IoMethod::Get, path, [&](uint64_t& bytes)
         {
-            if (++tried < retries)
+            if (endpoint.isHttpDerived())
             {
-                sleep(tried, "GET", endpoint.prefixedRoot() + path);
+                arbiter::http::Headers headers;
+                headers["Range"] =
+                    "bytes=" + std::to_string(begin) + "-" +
+                    std::to_string(end - 1);
+                data = endpoint.tryGetBinary(path, headers);
             }
-            else suicide("GET");
+            else if (endpoint.isLocal())
+            {
+                std::ifstream file(
+                        endpoint.fullPath(path),
+                        std::ios::in | std::ios::binary);
+
+                if (file.good())
+                {
+                    data = makeUnique<std::vector<char>>(end - begin);
+                    file.seekg(begin);
+                    file.read(data->data(), data->size());
+                    data->resize(file.gcount());
+                }
+            }
+            else
+            {
+                data = endpoint.tryGetBinary(path);
+            }
+
+            if (data) bytes = data->size();
+            return !!data;
+        });
+
+        // If we've received more than requested, then the range request was
+        // not honored and we have the full file.
+        if (data->size() > end - begin)
+        {
+            const uint64_t size(data->size());
+            data->erase(data->begin() + std::min(end, size), data->end());
+            data->erase(data->begin(), data->begin() + std::min(begin, size));
         }
-    }
 
-    return data;
+        return std::move(*data);
+    });
 }
 
 std::string ensureGetString(
@@ -116,29 +138,18 @@ std::string ensureGet(const arbiter::Arbiter& a, const std::string& path)
 {
     std::unique_ptr<std::string> data;
 
-    bool done(false);
-    std::size_t tried(0);
-
-    while (!done)
-    {
-        data = a.tryGet(path);
-
-        if (data)
-        {
-            done = true;
-        }
-        else
-        {
-            if (++tried < retries)
+    IoScheduler::instance().run(
+            arbiter::util::getNonBasename(path) + "/",
+            IoMethod::Get,
+            arbiter::util::getBasename(path),
+            [&](uint64_t& bytes)
             {
-                sleep(tried, "GET", path);
-            }
-            else suicide("GET");
-        }
-    }
+                data = a.tryGet(path);
+                if (data) bytes = data->size();
+                return !!data;
+            });
 
     return *data;
 }
 
 } // namespace entwine
-
@@ -36,6 +36,15 @@ std::unique_ptr<std::vector<char>> ensureGet(
         const arbiter::Endpoint& endpoint,
         const std::string& path);
 
+// Get the bytes in the range [begin, end) of _path_, which may be fewer than
+// requested if the file ends before _end_.  Ranged requests are used where
+// the endpoint supports them, otherwise the full file is fetched and sliced.
+std::vector<char> ensureGet(
+        const arbiter::Endpoint& endpoint,
+        const std::string& path,
+        uint64_t begin,
+        uint64_t end);
+
 std::string ensureGetString(
         const arbiter::Endpoint& endpoint,
         const std::string& path);
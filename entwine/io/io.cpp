@@ -13,7 +13,9 @@
 #include <stdexcept>
 
 #include <entwine/io/binary.hpp>
+#include <entwine/io/columnar.hpp>
 #include <entwine/io/laszip.hpp>
+#include <entwine/io/spatial.hpp>
 #include <entwine/io/zstandard.hpp>
 
 #include <entwine/util/unique.hpp>
@@ -21,15 +23,83 @@
 namespace entwine
 {
 
-std::unique_ptr<DataIo> DataIo::create(const Metadata& m, std::string type)
+namespace
+{
+
+std::unique_ptr<DataIo> createType(
+        const Metadata& m,
+        const std::string type,
+        const Json::Value& options)
 {
     if (type == "laszip") return makeUnique<Laz>(m);
     if (type == "binary") return makeUnique<Binary>(m);
-    /*
-    if (type == "zstandard") return makeUnique<Zstandard>(m);
-    */
+    if (type == "columnar") return makeUnique<Columnar>(m);
+    if (type == "spatial") return makeUnique<Spatial>(m);
+#ifdef ENTWINE_HAVE_ZSTD
+    if (type == "zstandard") return makeUnique<Zstandard>(m, options);
+#else
+    if (type == "zstandard")
+    {
+        throw std::runtime_error("Entwine was not built with Zstandard");
+    }
+#endif
     throw std::runtime_error("Invalid data IO type: " + type);
 }
 
+} // unnamed namespace
+
+std::unique_ptr<DataIo> DataIo::create(
+        const Metadata& m,
+        const std::string type,
+        const Json::Value& options)
+{
+    std::unique_ptr<DataIo> io(createType(m, type, options));
+
+    const Json::Value& pack(options["pack"]);
+    if (pack.isObject() || pack.asBool())
+    {
+        io->m_archive = makeUnique<Archive>(pack);
+    }
+
+    return io;
+}
+
+Json::Value DataIo::toJson() const
+{
+    Json::Value json(options());
+    if (m_archive) json["pack"] = m_archive->toJson();
+    return json;
+}
+
+void DataIo::store(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        const std::string& filename,
+        const std::vector<char>& data) const
+{
+    if (m_archive) m_archive->put(out, tmp, filename, data);
+    else ensurePut(out, filename, data);
+}
+
+std::vector<char> DataIo::fetch(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        const std::string& filename) const
+{
+    if (m_archive) return m_archive->get(out, tmp, filename);
+    return std::move(*ensureGet(out, filename));
+}
+
+std::vector<char> DataIo::fetch(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        const std::string& filename,
+        const uint64_t begin,
+        const uint64_t end) const
+{
+    if (m_archive) return m_archive->get(out, tmp, filename, begin, end);
+    return ensureGet(out, filename, begin, end);
+}
+
 } // namespace entwine
 
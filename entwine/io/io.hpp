@@ -12,10 +12,14 @@
 
 #include <cstdint>
 #include <memory>
+#include <set>
+#include <stdexcept>
 #include <string>
+#include <vector>
 
 #include <json/json.h>
 
+#include <entwine/io/archive.hpp>
 #include <entwine/io/ensure.hpp>
 #include <entwine/types/metadata.hpp>
 #include <entwine/types/vector-point-table.hpp>
@@ -29,10 +33,33 @@ public:
     DataIo(const Metadata& metadata) : m_metadata(metadata) { }
     virtual ~DataIo() { }
 
-    static std::unique_ptr<DataIo> create(const Metadata& m, std::string type);
+    static std::unique_ptr<DataIo> create(
+            const Metadata& m,
+            std::string type,
+            const Json::Value& options = Json::Value());
 
     virtual std::string type() const = 0;
 
+    // The suffix of the node files written by this type.
+    virtual std::string extension() const = 0;
+
+    // All options, persisted with the build parameters so that continued
+    // builds and readers are configured identically.
+    Json::Value toJson() const;
+
+    // Any type-specific options.
+    virtual Json::Value options() const { return Json::Value(); }
+
+    // True if node files are packed into shared archives.
+    bool packed() const { return !!m_archive; }
+
+    // Finalize any node data which has been staged locally.  This must be
+    // called after all nodes have been written.
+    void save(const arbiter::Endpoint& out, const arbiter::Endpoint& tmp) const
+    {
+        if (m_archive) m_archive->save(out, tmp);
+    }
+
     virtual void write(
             const arbiter::Endpoint& out,
             const arbiter::Endpoint& tmp,
@@ -48,8 +75,60 @@ public:
             VectorPointTable& table) const
     { }
 
+    // The node file _filename_ as it is stored, in the format of this type.
+    std::vector<char> stored(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            const std::string& filename) const
+    {
+        return fetch(out, tmp, filename + extension());
+    }
+
+    // True if this type stores dimensions separately, in which case readDims
+    // may be used to read only a subset of them.
+    virtual bool columnar() const { return false; }
+
+    // Read only the dimensions named in _dims_ into _data_, which is laid out
+    // according to the absolute schema.  If _data_ is empty, it is resized to
+    // fit all points with the remaining dimensions zero-filled, otherwise it
+    // must already hold all points and its other dimensions are untouched.
+    virtual void readDims(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            const std::string& filename,
+            const std::set<std::string>& dims,
+            std::vector<char>& data) const
+    {
+        throw std::runtime_error(
+                "Cannot read individual dimensions with type " + type());
+    }
+
 protected:
+    // Store and fetch node files, which are packed into archives if packing
+    // is enabled.  Other files should use the endpoint directly.
+    void store(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            const std::string& filename,
+            const std::vector<char>& data) const;
+
+    std::vector<char> fetch(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            const std::string& filename) const;
+
+    // Fetch the range [begin, end) of a node file.
+    std::vector<char> fetch(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            const std::string& filename,
+            uint64_t begin,
+            uint64_t end) const;
+
     const Metadata& m_metadata;
+
+private:
+    std::unique_ptr<Archive> m_archive;
 };
 
 } // namespace entwine
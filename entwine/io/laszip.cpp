@@ -10,16 +10,253 @@
 
 #include <entwine/io/laszip.hpp>
 
+#ifdef ENTWINE_HAVE_LASZIP
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <sstream>
+#include <streambuf>
+
+#include <laszip/laszip_api.h>
+
+#include <pdal/PointRef.hpp>
+
+#else
+
 #include <pdal/filters/SortFilter.hpp>
 #include <pdal/io/BufferReader.hpp>
 #include <pdal/io/LasReader.hpp>
 #include <pdal/io/LasWriter.hpp>
 
+#endif
+
+#include <entwine/types/scale-offset.hpp>
 #include <entwine/util/executor.hpp>
 
 namespace entwine
 {
 
+#ifdef ENTWINE_HAVE_LASZIP
+
+namespace
+{
+
+// Header sizes of LAS 1.2 and 1.4.
+const uint16_t headerSize(227);
+const uint16_t extendedHeaderSize(375);
+const uint16_t descriptorSize(192);
+
+// Point record sizes for formats 0 through 3, excluding extra bytes.
+const uint16_t recordSizes[] = { 20, 28, 26, 34 };
+
+bool hasTime(uint8_t format) { return format & 1; }
+bool hasColor(uint8_t format) { return format & 2; }
+
+// See https://www.pdal.io/stages/writers.las.html
+uint8_t pointFormat(const Schema& s)
+{
+    return (s.hasTime() ? 1 : 0) | (s.hasColor() ? 2 : 0);
+}
+
+bool isStandard(const DimId id, const uint8_t format)
+{
+    switch (id)
+    {
+        case DimId::X:
+        case DimId::Y:
+        case DimId::Z:
+        case DimId::Intensity:
+        case DimId::ReturnNumber:
+        case DimId::NumberOfReturns:
+        case DimId::ScanDirectionFlag:
+        case DimId::EdgeOfFlightLine:
+        case DimId::Classification:
+        case DimId::ScanAngleRank:
+        case DimId::UserData:
+        case DimId::PointSourceId:
+            return true;
+        case DimId::GpsTime:
+            return hasTime(format);
+        case DimId::Red:
+        case DimId::Green:
+        case DimId::Blue:
+            return hasColor(format);
+        default:
+            return false;
+    }
+}
+
+// Extra bytes data types from the LAS 1.4 specification.
+uint8_t extraBytesType(const pdal::Dimension::Type type)
+{
+    using Type = pdal::Dimension::Type;
+
+    switch (type)
+    {
+        case Type::Unsigned8:   return 1;
+        case Type::Signed8:     return 2;
+        case Type::Unsigned16:  return 3;
+        case Type::Signed16:    return 4;
+        case Type::Unsigned32:  return 5;
+        case Type::Signed32:    return 6;
+        case Type::Unsigned64:  return 7;
+        case Type::Signed64:    return 8;
+        case Type::Float:       return 9;
+        case Type::Double:      return 10;
+        default: throw std::runtime_error("Invalid extra bytes type");
+    }
+}
+
+pdal::Dimension::Type extraBytesType(const uint8_t type)
+{
+    using Type = pdal::Dimension::Type;
+
+    switch (type)
+    {
+        case 1:     return Type::Unsigned8;
+        case 2:     return Type::Signed8;
+        case 3:     return Type::Unsigned16;
+        case 4:     return Type::Signed16;
+        case 5:     return Type::Unsigned32;
+        case 6:     return Type::Signed32;
+        case 7:     return Type::Unsigned64;
+        case 8:     return Type::Signed64;
+        case 9:     return Type::Float;
+        case 10:    return Type::Double;
+        default:    return Type::None;
+    }
+}
+
+// A dimension stored in the extra bytes of each point record.
+struct Extra
+{
+    Extra(DimId id, pdal::Dimension::Type type, std::size_t offset)
+        : id(id)
+        , type(type)
+        , offset(offset)
+    { }
+
+    DimId id;
+    pdal::Dimension::Type type;
+    std::size_t offset;
+};
+
+// Which of the standard LAS fields are present in a schema.
+struct Fields
+{
+    explicit Fields(const Schema& s)
+        : Fields([&s](const DimId id) { return s.contains(id); })
+    { }
+
+    template<typename Has>
+    explicit Fields(const Has& has)
+        : intensity(has(DimId::Intensity))
+        , returnNumber(has(DimId::ReturnNumber))
+        , numberOfReturns(has(DimId::NumberOfReturns))
+        , scanDirectionFlag(has(DimId::ScanDirectionFlag))
+        , edgeOfFlightLine(has(DimId::EdgeOfFlightLine))
+        , classification(has(DimId::Classification))
+        , scanAngleRank(has(DimId::ScanAngleRank))
+        , userData(has(DimId::UserData))
+        , pointSourceId(has(DimId::PointSourceId))
+        , gpsTime(has(DimId::GpsTime))
+        , red(has(DimId::Red))
+        , green(has(DimId::Green))
+        , blue(has(DimId::Blue))
+    { }
+
+    const bool intensity;
+    const bool returnNumber;
+    const bool numberOfReturns;
+    const bool scanDirectionFlag;
+    const bool edgeOfFlightLine;
+    const bool classification;
+    const bool scanAngleRank;
+    const bool userData;
+    const bool pointSourceId;
+    const bool gpsTime;
+    const bool red;
+    const bool green;
+    const bool blue;
+};
+
+template<typename T>
+T getAs(const pdal::PointRef& pr, const DimId id, const bool has)
+{
+    return has ? pr.getFieldAs<T>(id) : T(0);
+}
+
+// A read-only, seekable stream buffer over existing memory.
+class MemoryBuffer : public std::streambuf
+{
+public:
+    MemoryBuffer(char* data, std::size_t size)
+    {
+        setg(data, data, data + size);
+    }
+
+protected:
+    virtual pos_type seekoff(
+            off_type off,
+            std::ios_base::seekdir dir,
+            std::ios_base::openmode which) override
+    {
+        char* pos(
+                dir == std::ios_base::beg ? eback() :
+                dir == std::ios_base::cur ? gptr() :
+                egptr());
+
+        pos += off;
+        if (pos < eback() || pos > egptr()) return pos_type(off_type(-1));
+
+        setg(eback(), pos, egptr());
+        return pos_type(pos - eback());
+    }
+
+    virtual pos_type seekpos(
+            pos_type pos,
+            std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+};
+
+class Handle
+{
+public:
+    Handle()
+    {
+        if (laszip_create(&m_pointer) || !m_pointer)
+        {
+            throw std::runtime_error("Could not create LASzip handle");
+        }
+    }
+
+    ~Handle() { laszip_destroy(m_pointer); }
+
+    void check(const laszip_I32 result) const
+    {
+        if (!result) return;
+
+        laszip_CHAR* error(nullptr);
+        laszip_get_error(m_pointer, &error);
+        throw std::runtime_error(
+                std::string("LASzip error: ") + (error ? error : "unknown"));
+    }
+
+    laszip_POINTER get() const { return m_pointer; }
+
+private:
+    laszip_POINTER m_pointer = nullptr;
+
+    Handle(const Handle&);
+    Handle& operator=(const Handle&);
+};
+
+} // unnamed namespace
+
 void Laz::write(
         const arbiter::Endpoint& out,
         const arbiter::Endpoint& tmp,
@@ -27,7 +264,510 @@ void Laz::write(
         const Bounds& bounds,
         BlockPointTable& table) const
 {
-    const bool local(out.isLocal());
+    store(
+            out,
+            tmp,
+            filename + ".laz",
+            encode(
+                m_metadata.schema(),
+                m_metadata.outSchema(),
+                m_metadata.srs(),
+                table));
+}
+
+std::vector<char> Laz::encode(
+        const Schema& schema,
+        const Schema& outSchema,
+        const Srs& srs,
+        BlockPointTable& table)
+{
+    // Absolute builds have no scale and offset, and we won't round their
+    // coordinates to integers behind their backs.
+    const std::unique_ptr<ScaleOffset> so(outSchema.scaleOffset());
+    if (!so) throw std::runtime_error("Laszip output requires scaling.");
+
+    const Scale& scale(so->scale());
+    const Offset& offset(so->offset());
+
+    const uint64_t np(table.size());
+
+    const uint8_t format(pointFormat(outSchema));
+    const Fields fields(outSchema);
+
+    // Any dimensions without a standard field for this point format are
+    // stored as extra bytes, described by an extra bytes VLR.
+    std::vector<Extra> extras;
+    std::vector<laszip_U8> descriptors;
+    std::size_t extraSize(0);
+
+    for (const DimInfo& d : outSchema.dims())
+    {
+        if (isStandard(d.id(), format)) continue;
+
+        extras.emplace_back(schema.find(d.name()).id(), d.type(), extraSize);
+        extraSize += d.size();
+
+        descriptors.resize(descriptors.size() + descriptorSize, 0);
+        laszip_U8* pos(
+                descriptors.data() + descriptors.size() - descriptorSize);
+        pos[2] = extraBytesType(d.type());
+        std::strncpy(reinterpret_cast<char*>(pos + 4), d.name().c_str(), 32);
+    }
+
+    pdal::PointRef pr(table, 0);
+
+    // Order our points by GpsTime if possible, which generally improves
+    // compression, and gather the header statistics.
+    std::vector<uint64_t> order(np);
+    std::iota(order.begin(), order.end(), 0);
+
+    if (fields.gpsTime)
+    {
+        std::vector<double> times(np);
+        for (uint64_t i(0); i < np; ++i)
+        {
+            pr.setPointId(i);
+            times[i] = pr.getFieldAs<double>(DimId::GpsTime);
+        }
+
+        std::stable_sort(
+                order.begin(),
+                order.end(),
+                [&times](uint64_t a, uint64_t b)
+                {
+                    return times[a] < times[b];
+                });
+    }
+
+    std::vector<Point> scaled(np);
+    Bounds extents(Bounds::expander());
+    uint32_t byReturn[5] = { 0, 0, 0, 0, 0 };
+
+    for (uint64_t i(0); i < np; ++i)
+    {
+        pr.setPointId(order[i]);
+
+        Point& p(scaled[i]);
+        p.x = pr.getFieldAs<double>(DimId::X);
+        p.y = pr.getFieldAs<double>(DimId::Y);
+        p.z = pr.getFieldAs<double>(DimId::Z);
+        p = Point::scale(p, scale, offset).round();
+
+        extents.grow(Point::unscale(p, scale, offset));
+
+        const uint64_t r(getAs<uint8_t>(pr, DimId::ReturnNumber,
+                    fields.returnNumber));
+        if (r >= 1 && r <= 5) ++byReturn[r - 1];
+    }
+
+    Handle handle;
+    laszip_POINTER h(handle.get());
+
+    laszip_header* header(nullptr);
+    handle.check(laszip_get_header_pointer(h, &header));
+
+    const std::string software(
+            "Entwine " + currentEntwineVersion().toString());
+
+    // LAS 1.2 only defines GeoTIFF keys for the coordinate system, while
+    // LAS 1.4 allows WKT for any point format, so files with a coordinate
+    // system are written as 1.4.  The legacy point counts remain valid for
+    // our point formats, so readers of either version see the same counts.
+    const bool wkt(srs.exists());
+    const uint16_t size(wkt ? extendedHeaderSize : headerSize);
+
+    header->global_encoding = wkt ? 16 : 0;
+    header->version_major = 1;
+    header->version_minor = wkt ? 4 : 2;
+    std::strncpy(header->system_identifier, "Entwine", 32);
+    std::strncpy(header->generating_software, software.c_str(), 32);
+    header->header_size = size;
+    header->offset_to_point_data = size;
+    header->point_data_format = format;
+    header->point_data_record_length = recordSizes[format] + extraSize;
+    header->number_of_point_records = np;
+    std::copy(byReturn, byReturn + 5, header->number_of_points_by_return);
+
+    if (wkt)
+    {
+        header->extended_number_of_point_records = np;
+        std::copy(
+                byReturn,
+                byReturn + 5,
+                header->extended_number_of_points_by_return);
+    }
+
+    header->x_scale_factor = scale.x;
+    header->y_scale_factor = scale.y;
+    header->z_scale_factor = scale.z;
+    header->x_offset = offset.x;
+    header->y_offset = offset.y;
+    header->z_offset = offset.z;
+
+    if (np)
+    {
+        header->min_x = extents.min().x;
+        header->min_y = extents.min().y;
+        header->min_z = extents.min().z;
+        header->max_x = extents.max().x;
+        header->max_y = extents.max().y;
+        header->max_z = extents.max().z;
+    }
+
+    if (!descriptors.empty())
+    {
+        handle.check(
+                laszip_add_vlr(
+                    h,
+                    "LASF_Spec",
+                    4,
+                    descriptors.size(),
+                    "Extra bytes",
+                    descriptors.data()));
+    }
+
+    if (wkt)
+    {
+        const std::string& s(srs.wkt());
+        handle.check(
+                laszip_add_vlr(
+                    h,
+                    "LASF_Projection",
+                    2112,
+                    s.size() + 1,
+                    "OGC WKT",
+                    reinterpret_cast<const laszip_U8*>(s.c_str())));
+    }
+
+    std::ostringstream os;
+    handle.check(laszip_open_writer_stream(h, os, 1, 0));
+
+    laszip_point* point(nullptr);
+    handle.check(laszip_get_point_pointer(h, &point));
+
+    for (uint64_t i(0); i < np; ++i)
+    {
+        pr.setPointId(order[i]);
+
+        const Point& p(scaled[i]);
+        point->X = static_cast<laszip_I32>(p.x);
+        point->Y = static_cast<laszip_I32>(p.y);
+        point->Z = static_cast<laszip_I32>(p.z);
+
+        point->intensity =
+            getAs<uint16_t>(pr, DimId::Intensity, fields.intensity);
+        point->return_number =
+            getAs<uint8_t>(pr, DimId::ReturnNumber, fields.returnNumber);
+        point->number_of_returns =
+            getAs<uint8_t>(pr, DimId::NumberOfReturns, fields.numberOfReturns);
+        point->scan_direction_flag = getAs<uint8_t>(
+                pr, DimId::ScanDirectionFlag, fields.scanDirectionFlag);
+        point->edge_of_flight_line = getAs<uint8_t>(
+                pr, DimId::EdgeOfFlightLine, fields.edgeOfFlightLine);
+
+        // Like PDAL, we treat the full byte as the classification for these
+        // point formats.
+        const uint8_t c(getAs<uint8_t>(
+                pr, DimId::Classification, fields.classification));
+        point->classification = c & 0x1F;
+        point->synthetic_flag = (c >> 5) & 1;
+        point->keypoint_flag = (c >> 6) & 1;
+        point->withheld_flag = (c >> 7) & 1;
+
+        point->scan_angle_rank =
+            getAs<int8_t>(pr, DimId::ScanAngleRank, fields.scanAngleRank);
+        point->user_data =
+            getAs<uint8_t>(pr, DimId::UserData, fields.userData);
+        point->point_source_ID =
+            getAs<uint16_t>(pr, DimId::PointSourceId, fields.pointSourceId);
+
+        if (hasTime(format))
+        {
+            point->gps_time = pr.getFieldAs<double>(DimId::GpsTime);
+        }
+
+        if (hasColor(format))
+        {
+            point->rgb[0] = getAs<uint16_t>(pr, DimId::Red, fields.red);
+            point->rgb[1] = getAs<uint16_t>(pr, DimId::Green, fields.green);
+            point->rgb[2] = getAs<uint16_t>(pr, DimId::Blue, fields.blue);
+        }
+
+        for (const Extra& e : extras)
+        {
+            pr.getField(
+                    reinterpret_cast<char*>(point->extra_bytes + e.offset),
+                    e.id,
+                    e.type);
+        }
+
+        handle.check(laszip_write_point(h));
+    }
+
+    handle.check(laszip_close_writer(h));
+
+    const std::string data(os.str());
+    return std::vector<char>(data.begin(), data.end());
+}
+
+void Laz::read(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        const std::string& filename,
+        VectorPointTable& table) const
+{
+    const Schema& schema(m_metadata.schema());
+
+    std::vector<char> data(fetch(out, tmp, filename + ".laz"));
+    MemoryBuffer buffer(data.data(), data.size());
+    std::istream is(&buffer);
+
+    LaszipReader reader(is, filename);
+    reader.select([&schema](const std::string& name)
+    {
+        return schema.contains(name) ? schema.find(name).id() : DimId::Unknown;
+    });
+
+    const uint64_t np(reader.points());
+    pdal::PointRef pr(table, 0);
+
+    for (uint64_t begin(0); begin < np; begin += table.capacity())
+    {
+        const uint64_t n(std::min<uint64_t>(table.capacity(), np - begin));
+
+        for (uint64_t i(0); i < n; ++i)
+        {
+            pr.setPointId(i);
+            reader.read(pr);
+        }
+
+        table.clear(n);
+    }
+}
+
+class LaszipReader::Impl
+{
+public:
+    Impl(std::istream& is, const std::string& name)
+    {
+        laszip_POINTER h(m_handle.get());
+
+        laszip_BOOL compressed(0);
+        m_handle.check(laszip_open_reader_stream(h, is, &compressed));
+        m_handle.check(laszip_get_header_pointer(h, &m_header));
+        m_handle.check(laszip_get_point_pointer(h, &m_point));
+
+        m_format = m_header->point_data_format;
+        if (m_format > 3)
+        {
+            throw std::runtime_error(
+                    "Unsupported point format " + std::to_string(m_format) +
+                    " in " + name);
+        }
+
+        m_points = m_header->number_of_point_records ?
+            m_header->number_of_point_records :
+            m_header->extended_number_of_point_records;
+
+        m_scale = Scale(
+                m_header->x_scale_factor,
+                m_header->y_scale_factor,
+                m_header->z_scale_factor);
+        m_offset = Offset(
+                m_header->x_offset,
+                m_header->y_offset,
+                m_header->z_offset);
+
+        for (laszip_U32 i(0); i < m_header->number_of_variable_length_records;
+                ++i)
+        {
+            const laszip_vlr& vlr(m_header->vlrs[i]);
+            const bool spec(!std::strncmp(vlr.user_id, "LASF_Spec", 16));
+            const bool proj(!std::strncmp(vlr.user_id, "LASF_Projection", 16));
+
+            if (proj && vlr.record_id == 2112)
+            {
+                const char* wkt(reinterpret_cast<const char*>(vlr.data));
+                m_wkt.assign(wkt, strnlen(wkt, vlr.record_length_after_header));
+            }
+
+            if (!spec || vlr.record_id != 4) continue;
+
+            std::size_t extraOffset(0);
+            const uint16_t n(vlr.record_length_after_header / descriptorSize);
+
+            for (uint16_t d(0); d < n; ++d)
+            {
+                const laszip_U8* pos(vlr.data + d * descriptorSize);
+                const pdal::Dimension::Type type(extraBytesType(pos[2]));
+
+                // Undocumented extra bytes store their size in the options
+                // field.
+                const std::size_t size(
+                        type == pdal::Dimension::Type::None ?
+                            pos[3] : pdal::Dimension::size(type));
+
+                const std::string name(
+                        reinterpret_cast<const char*>(pos + 4),
+                        strnlen(reinterpret_cast<const char*>(pos + 4), 32));
+
+                if (type != pdal::Dimension::Type::None)
+                {
+                    m_extraDims.push_back(ExtraDim { name, type });
+                    m_extraOffsets.push_back(extraOffset);
+                }
+
+                extraOffset += size;
+            }
+        }
+    }
+
+    ~Impl()
+    {
+        laszip_close_reader(m_handle.get());
+    }
+
+    uint64_t points() const { return m_points; }
+    uint8_t format() const { return m_format; }
+    const std::string& wkt() const { return m_wkt; }
+    const std::vector<ExtraDim>& extraDims() const { return m_extraDims; }
+
+    void select(const Lookup& lookup)
+    {
+        m_fields = makeUnique<Fields>([&lookup](const DimId id)
+        {
+            return lookup(pdal::Dimension::name(id)) == id;
+        });
+
+        m_extras.clear();
+        for (std::size_t i(0); i < m_extraDims.size(); ++i)
+        {
+            const ExtraDim& e(m_extraDims[i]);
+            const DimId id(lookup(e.name));
+            if (id != DimId::Unknown)
+            {
+                m_extras.emplace_back(id, e.type, m_extraOffsets[i]);
+            }
+        }
+    }
+
+    void read(pdal::PointRef& pr)
+    {
+        if (!m_fields) throw std::runtime_error("No dimensions selected");
+        const Fields& fields(*m_fields);
+        const laszip_point* point(m_point);
+
+        m_handle.check(laszip_read_point(m_handle.get()));
+
+        pr.setField(DimId::X, Point::unscale(point->X, m_scale.x, m_offset.x));
+        pr.setField(DimId::Y, Point::unscale(point->Y, m_scale.y, m_offset.y));
+        pr.setField(DimId::Z, Point::unscale(point->Z, m_scale.z, m_offset.z));
+
+        if (fields.intensity)
+        {
+            pr.setField(DimId::Intensity, point->intensity);
+        }
+        if (fields.returnNumber)
+        {
+            pr.setField(DimId::ReturnNumber, point->return_number);
+        }
+        if (fields.numberOfReturns)
+        {
+            pr.setField(DimId::NumberOfReturns, point->number_of_returns);
+        }
+        if (fields.scanDirectionFlag)
+        {
+            pr.setField(DimId::ScanDirectionFlag, point->scan_direction_flag);
+        }
+        if (fields.edgeOfFlightLine)
+        {
+            pr.setField(DimId::EdgeOfFlightLine, point->edge_of_flight_line);
+        }
+        if (fields.classification)
+        {
+            const uint8_t c(
+                    point->classification |
+                    (point->synthetic_flag << 5) |
+                    (point->keypoint_flag << 6) |
+                    (point->withheld_flag << 7));
+            pr.setField(DimId::Classification, c);
+        }
+        if (fields.scanAngleRank)
+        {
+            pr.setField(DimId::ScanAngleRank, point->scan_angle_rank);
+        }
+        if (fields.userData)
+        {
+            pr.setField(DimId::UserData, point->user_data);
+        }
+        if (fields.pointSourceId)
+        {
+            pr.setField(DimId::PointSourceId, point->point_source_ID);
+        }
+        if (hasTime(m_format) && fields.gpsTime)
+        {
+            pr.setField(DimId::GpsTime, point->gps_time);
+        }
+        if (hasColor(m_format))
+        {
+            if (fields.red) pr.setField(DimId::Red, point->rgb[0]);
+            if (fields.green) pr.setField(DimId::Green, point->rgb[1]);
+            if (fields.blue) pr.setField(DimId::Blue, point->rgb[2]);
+        }
+
+        for (const Extra& e : m_extras)
+        {
+            pr.setField(e.id, e.type, point->extra_bytes + e.offset);
+        }
+    }
+
+private:
+    Handle m_handle;
+    laszip_header* m_header = nullptr;
+    laszip_point* m_point = nullptr;
+
+    uint8_t m_format = 0;
+    uint64_t m_points = 0;
+    Scale m_scale;
+    Offset m_offset;
+    std::string m_wkt;
+
+    std::vector<ExtraDim> m_extraDims;
+    std::vector<std::size_t> m_extraOffsets;
+
+    std::unique_ptr<Fields> m_fields;
+    std::vector<Extra> m_extras;
+};
+
+LaszipReader::LaszipReader(std::istream& is, const std::string& name)
+    : m_impl(makeUnique<Impl>(is, name))
+{ }
+
+LaszipReader::~LaszipReader() { }
+
+uint64_t LaszipReader::points() const { return m_impl->points(); }
+uint8_t LaszipReader::format() const { return m_impl->format(); }
+std::string LaszipReader::wkt() const { return m_impl->wkt(); }
+
+const std::vector<LaszipReader::ExtraDim>& LaszipReader::extraDims() const
+{
+    return m_impl->extraDims();
+}
+
+void LaszipReader::select(const Lookup& lookup) { m_impl->select(lookup); }
+void LaszipReader::read(pdal::PointRef& pr) { m_impl->read(pr); }
+
+#else
+
+void Laz::write(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        const std::string& filename,
+        const Bounds& bounds,
+        BlockPointTable& table) const
+{
+    // Packed nodes are staged locally and then appended to their archive.
+    const bool local(out.isLocal() && !packed());
     const std::string localDir(
             local ? out.prefixedRoot() : tmp.prefixedRoot());
     const std::string localFile(
@@ -91,7 +831,7 @@ void Laz::write(
 
     if (!local)
     {
-        ensurePut(out, filename + ".laz", tmp.getBinary(localFile));
+        store(out, tmp, filename + ".laz", tmp.getBinary(localFile));
         arbiter::fs::remove(tmp.prefixedRoot() + localFile);
     }
 }
@@ -102,10 +842,25 @@ void Laz::read(
         const std::string& filename,
         VectorPointTable& table) const
 {
-    auto handle(out.getLocalHandle(filename + ".laz"));
+    std::string localPath;
+    std::unique_ptr<arbiter::fs::LocalHandle> handle;
+
+    if (packed())
+    {
+        const std::string localFile(
+                arbiter::crypto::encodeAsHex(
+                    out.prefixedRoot() + filename) + ".laz");
+        localPath = tmp.prefixedRoot() + localFile;
+        ensurePut(tmp, localFile, fetch(out, tmp, filename + ".laz"));
+    }
+    else
+    {
+        handle = out.getLocalHandle(filename + ".laz");
+        localPath = handle->localPath();
+    }
 
     pdal::Options o;
-    o.add("filename", handle->localPath());
+    o.add("filename", localPath);
     o.add("use_eb_vlr", true);
 
     pdal::LasReader reader;
@@ -117,7 +872,10 @@ void Laz::read(
     }
 
     reader.execute(table);
+
+    if (packed()) arbiter::fs::remove(localPath);
 }
 
-} // namespace entwine
+#endif
 
+} // namespace entwine
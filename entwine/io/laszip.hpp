@@ -10,7 +10,19 @@
 
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef ENTWINE_HAVE_LASZIP
+#include <pdal/PointRef.hpp>
+#endif
+
 #include <entwine/io/io.hpp>
+#include <entwine/types/srs.hpp>
 
 namespace entwine
 {
@@ -28,6 +40,7 @@ public:
     }
 
     virtual std::string type() const override { return "laszip"; }
+    virtual std::string extension() const override { return ".laz"; }
 
     virtual void write(
             const arbiter::Endpoint& out,
@@ -41,7 +54,62 @@ public:
             const arbiter::Endpoint& tmp,
             const std::string& filename,
             VectorPointTable& table) const override;
+
+#ifdef ENTWINE_HAVE_LASZIP
+    // Encode the points of _table_, laid out according to _schema_, as a LAZ
+    // file of the dimensions of _outSchema_, which must be scaled.  The file
+    // is LAS 1.4 if _srs_ exists, so that it may be stored as WKT, and LAS
+    // 1.2 otherwise.
+    static std::vector<char> encode(
+            const Schema& schema,
+            const Schema& outSchema,
+            const Srs& srs,
+            BlockPointTable& table);
+#endif
+};
+
+#ifdef ENTWINE_HAVE_LASZIP
+
+// Decodes the point records of a LAS or LAZ file, of point formats 0 through
+// 3, from a seekable stream.
+class LaszipReader
+{
+public:
+    // Returns the ID of the destination dimension of this name, or
+    // DimId::Unknown if the dimension should not be read.
+    using Lookup = std::function<DimId(const std::string& name)>;
+
+    struct ExtraDim
+    {
+        std::string name;
+        pdal::Dimension::Type type;
+    };
+
+    // Throws if the header cannot be read or its point format is unsupported.
+    LaszipReader(std::istream& is, const std::string& name);
+    ~LaszipReader();
+
+    uint64_t points() const;
+    uint8_t format() const;
+
+    // The coordinate system of the file, if it is stored as WKT.
+    std::string wkt() const;
+
+    // Dimensions stored in the extra bytes of each point record.
+    const std::vector<ExtraDim>& extraDims() const;
+
+    // Select the dimensions to be read.  This must be called before reading.
+    void select(const Lookup& lookup);
+
+    // Read the next point record into _pr_.
+    void read(pdal::PointRef& pr);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> m_impl;
 };
 
+#endif
+
 } // namespace entwine
 
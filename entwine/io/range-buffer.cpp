@@ -0,0 +1,128 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/io/range-buffer.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <entwine/io/ensure.hpp>
+
+namespace entwine
+{
+
+RangeBuffer::RangeBuffer(
+        const arbiter::Endpoint& endpoint,
+        const std::string path,
+        const uint64_t size,
+        const uint64_t blockSize)
+    : m_endpoint(endpoint)
+    , m_path(path)
+    , m_size(size)
+    , m_blockSize(blockSize)
+{
+    if (!m_blockSize) throw std::runtime_error("Invalid block size");
+}
+
+RangeBuffer::~RangeBuffer()
+{
+    if (m_prefetch.valid()) m_prefetch.wait();
+}
+
+std::vector<char> RangeBuffer::fetch(const uint64_t begin) const
+{
+    const uint64_t end(std::min(begin + m_blockSize, m_size));
+    std::vector<char> data(ensureGet(m_endpoint, m_path, begin, end));
+
+    if (data.size() != end - begin)
+    {
+        throw std::runtime_error("Truncated read of " + m_path);
+    }
+
+    return data;
+}
+
+void RangeBuffer::load(const uint64_t begin)
+{
+    if (m_prefetch.valid())
+    {
+        // Wait for an outstanding prefetch even if we're not going to use
+        // it, since it references our state.
+        std::vector<char> next(m_prefetch.get());
+        if (m_next == begin) m_block = std::move(next);
+        else m_block = fetch(begin);
+    }
+    else m_block = fetch(begin);
+
+    m_begin = begin;
+    setg(m_block.data(), m_block.data(), m_block.data() + m_block.size());
+
+    m_next = begin + m_block.size();
+    if (m_next < m_size)
+    {
+        const uint64_t next(m_next);
+        m_prefetch = std::async(
+                std::launch::async,
+                [this, next]() { return fetch(next); });
+    }
+}
+
+RangeBuffer::int_type RangeBuffer::underflow()
+{
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+    const uint64_t pos(m_begin + m_block.size());
+    if (pos >= m_size) return traits_type::eof();
+
+    load(pos);
+    return traits_type::to_int_type(*gptr());
+}
+
+RangeBuffer::pos_type RangeBuffer::seekoff(
+        const off_type off,
+        const std::ios_base::seekdir dir,
+        const std::ios_base::openmode which)
+{
+    const int64_t base(
+            dir == std::ios_base::beg ? 0 :
+            dir == std::ios_base::cur ? m_begin + (gptr() - eback()) :
+            m_size);
+
+    const int64_t target(base + off);
+    if (target < 0 || static_cast<uint64_t>(target) > m_size)
+    {
+        return pos_type(off_type(-1));
+    }
+
+    const uint64_t pos(target);
+    if (pos >= m_begin && pos < m_begin + m_block.size())
+    {
+        setg(eback(), eback() + (pos - m_begin), egptr());
+    }
+    else
+    {
+        // Leave the buffer empty, so the next read loads the block starting
+        // at our new position.
+        m_block.clear();
+        m_begin = pos;
+        setg(nullptr, nullptr, nullptr);
+    }
+
+    return pos_type(off_type(pos));
+}
+
+RangeBuffer::pos_type RangeBuffer::seekpos(
+        const pos_type pos,
+        const std::ios_base::openmode which)
+{
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+} // namespace entwine
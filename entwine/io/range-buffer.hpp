@@ -0,0 +1,71 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+
+namespace entwine
+{
+
+// A read-only, seekable stream buffer over a file of known size, which is
+// fetched in blocks with ranged requests as it is read.  While a block is
+// consumed, the next one is fetched in the background, so that decoding the
+// stream may overlap its download.
+class RangeBuffer : public std::streambuf
+{
+public:
+    RangeBuffer(
+            const arbiter::Endpoint& endpoint,
+            std::string path,
+            uint64_t size,
+            uint64_t blockSize = 4 * 1024 * 1024);
+
+    ~RangeBuffer();
+
+protected:
+    virtual int_type underflow() override;
+
+    virtual pos_type seekoff(
+            off_type off,
+            std::ios_base::seekdir dir,
+            std::ios_base::openmode which) override;
+
+    virtual pos_type seekpos(
+            pos_type pos,
+            std::ios_base::openmode which) override;
+
+private:
+    std::vector<char> fetch(uint64_t begin) const;
+    void load(uint64_t begin);
+
+    const arbiter::Endpoint m_endpoint;
+    const std::string m_path;
+    const uint64_t m_size;
+    const uint64_t m_blockSize;
+
+    // File offset of the current block.
+    uint64_t m_begin = 0;
+    std::vector<char> m_block;
+
+    uint64_t m_next = 0;
+    std::future<std::vector<char>> m_prefetch;
+
+    RangeBuffer(const RangeBuffer&);
+    RangeBuffer& operator=(const RangeBuffer&);
+};
+
+} // namespace entwine
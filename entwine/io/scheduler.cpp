@@ -0,0 +1,380 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/io/scheduler.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+#include <entwine/util/unique.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    const std::size_t retries(40);
+    const std::chrono::milliseconds baseDelay(500);
+    const std::chrono::milliseconds maxDelay(30000);
+    const std::chrono::milliseconds putPatience(1000);
+
+    std::mutex logMutex;
+
+    std::string name(const IoMethod method)
+    {
+        return method == IoMethod::Get ? "GET" : "PUT";
+    }
+
+    // Jitter the exponential delay over its upper half, so that requests
+    // which failed together don't all retry together.
+    std::chrono::milliseconds delay(const std::size_t tried)
+    {
+        thread_local std::mt19937 gen(std::random_device{ }());
+
+        const auto ceiling(
+                std::min<uint64_t>(
+                    baseDelay.count() << std::min<std::size_t>(tried - 1, 16),
+                    maxDelay.count()));
+
+        std::uniform_int_distribution<uint64_t> dist(ceiling / 2, ceiling);
+        return std::chrono::milliseconds(dist(gen));
+    }
+
+    std::exception_ptr suicide(const IoMethod method)
+    {
+        const std::string m(name(method));
+
+        std::lock_guard<std::mutex> lock(logMutex);
+        std::cout <<
+            "\tFailed to " << m << " data: persistent failure.\n" <<
+            "\tThis is a non-recoverable error." <<
+            std::endl;
+
+        return std::make_exception_ptr(
+                std::runtime_error("Fatal error - could not " + m));
+    }
+}
+
+IoScheduler& IoScheduler::instance()
+{
+    static IoScheduler scheduler;
+    return scheduler;
+}
+
+IoScheduler::~IoScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_cv.notify_all();
+    for (std::thread& t : m_threads) t.join();
+}
+
+void IoScheduler::setConcurrency(const std::size_t n)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_concurrency = n;
+    m_cv.notify_all();
+}
+
+std::size_t IoScheduler::concurrency() const
+{
+    return m_concurrency;
+}
+
+IoScheduler::Root& IoScheduler::root(const std::string& name)
+{
+    auto& r(m_roots[name]);
+    if (!r) r = makeUnique<Root>();
+    return *r;
+}
+
+std::shared_future<void> IoScheduler::submit(
+        const std::string& rootName,
+        const IoMethod method,
+        const std::string& path,
+        const Attempt& attempt)
+{
+    Pending req(std::make_shared<Request>());
+    req->root = rootName;
+    req->method = method;
+    req->path = path;
+    req->attempt = attempt;
+    req->queued = Clock::now();
+
+    const std::shared_future<void> future(req->promise.get_future().share());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Root& r(root(rootName));
+
+    if (method == IoMethod::Get) r.gets.push_back(req);
+    else
+    {
+        ++m_writes[rootName + path];
+        invalidate(rootName + path);
+        r.puts.push_back(req);
+    }
+
+    // Our threads are only created as needed, and are then kept for the
+    // life of the process.
+    if (m_idle < dispatchable()) m_threads.emplace_back([this]() { work(); });
+    m_cv.notify_one();
+
+    return future;
+}
+
+void IoScheduler::run(
+        const std::string& rootName,
+        const IoMethod method,
+        const std::string& path,
+        const Attempt& attempt)
+{
+    submit(rootName, method, path, attempt).get();
+}
+
+std::size_t IoScheduler::dispatchable() const
+{
+    const std::size_t limit(m_concurrency);
+
+    std::size_t n(0);
+    for (const auto& p : m_roots)
+    {
+        const Root& r(*p.second);
+        const std::size_t queued(r.gets.size() + r.puts.size());
+
+        if (!limit) n += queued;
+        else if (r.active < limit) n += std::min(queued, limit - r.active);
+    }
+    return n;
+}
+
+IoScheduler::Pending IoScheduler::next(Clock::time_point& wake)
+{
+    const auto now(Clock::now());
+    const std::size_t limit(m_concurrency);
+
+    for (auto& p : m_roots)
+    {
+        Root& r(*p.second);
+
+        while (!r.delayed.empty() && r.delayed.begin()->first <= now)
+        {
+            const Pending req(r.delayed.begin()->second);
+            r.delayed.erase(r.delayed.begin());
+
+            if (req->method == IoMethod::Get) r.gets.push_back(req);
+            else r.puts.push_back(req);
+        }
+
+        if (!r.delayed.empty())
+        {
+            wake = std::min(wake, r.delayed.begin()->first);
+        }
+
+        if (limit && r.active >= limit) continue;
+
+        std::deque<Pending>* queue(nullptr);
+
+        if (!r.puts.empty() &&
+                (r.gets.empty() || now - r.puts.front()->queued >= putPatience))
+        {
+            queue = &r.puts;
+        }
+        else if (!r.gets.empty()) queue = &r.gets;
+
+        if (queue)
+        {
+            const Pending req(queue->front());
+            queue->pop_front();
+            ++r.active;
+            return req;
+        }
+    }
+
+    return Pending();
+}
+
+void IoScheduler::work()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (!m_stop)
+    {
+        Clock::time_point wake(Clock::time_point::max());
+        const Pending req(next(wake));
+
+        if (!req)
+        {
+            ++m_idle;
+            if (wake == Clock::time_point::max()) m_cv.wait(lock);
+            else m_cv.wait_until(lock, wake);
+            --m_idle;
+            continue;
+        }
+
+        Root& r(*m_roots[req->root]);
+        lock.unlock();
+
+        uint64_t bytes(0);
+        bool done(false);
+        const auto start(Clock::now());
+
+        try { done = req->attempt(bytes); }
+        catch (...) { done = false; }
+
+        const std::chrono::duration<double> elapsed(Clock::now() - start);
+
+        lock.lock();
+        --r.active;
+        finish(r, req, done, bytes, elapsed.count());
+        m_cv.notify_all();
+    }
+}
+
+void IoScheduler::finish(
+        Root& r,
+        const Pending req,
+        const bool done,
+        const uint64_t bytes,
+        const double seconds)
+{
+    const bool get(req->method == IoMethod::Get);
+
+    Stats& stats(r.stats);
+    ++stats.requests;
+    stats.seconds += seconds;
+
+    if (!done) ++stats.failures;
+    else if (get) stats.bytesRead += bytes;
+    else stats.bytesWritten += bytes;
+
+    const bool retry(!done && ++req->tried < retries);
+
+    if (!get && !retry)
+    {
+        const std::string key(req->root + req->path);
+        if (!--m_writes[key]) m_writes.erase(key);
+        invalidate(key);
+    }
+
+    if (done) req->promise.set_value();
+    else if (!retry) req->promise.set_exception(suicide(req->method));
+    else
+    {
+        {
+            std::lock_guard<std::mutex> lock(logMutex);
+            std::cout <<
+                "\tFailed " << name(req->method) << " attempt " <<
+                req->tried << ": " << req->root << req->path << std::endl;
+        }
+
+        r.delayed.emplace(Clock::now() + delay(req->tried), req);
+    }
+}
+
+void IoScheduler::invalidate(const std::string& path)
+{
+    // Ranged GETs of this path are keyed by it followed by their range.
+    for (
+            auto it(m_flights.lower_bound(path));
+            it != m_flights.end() && !it->first.compare(0, path.size(), path);
+            ++it)
+    {
+        it->second.stale = true;
+    }
+}
+
+std::vector<char> IoScheduler::coalesce(
+        const std::string& rootName,
+        const std::string& path,
+        const std::string& range,
+        const std::function<std::vector<char>()>& get)
+{
+    const std::string key(rootName + path + range);
+
+    std::promise<Shared> promise;
+    std::shared_future<Shared> future;
+    bool leader(false);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it(m_flights.find(key));
+
+        if (it == m_flights.end())
+        {
+            leader = true;
+            future = promise.get_future().share();
+            m_flights[key].future = future;
+            if (m_writes.count(rootName + path)) m_flights[key].stale = true;
+        }
+        else if (!it->second.stale)
+        {
+            ++it->second.followers;
+            future = it->second.future;
+            ++root(rootName).stats.coalesced;
+        }
+    }
+
+    // A GET in flight for this key may predate a PUT of newer data, so we
+    // read it ourselves without being shared.
+    if (!future.valid()) return get();
+
+    if (!leader) return *future.get();
+
+    try
+    {
+        promise.set_value(std::make_shared<std::vector<char>>(get()));
+    }
+    catch (...)
+    {
+        promise.set_exception(std::current_exception());
+    }
+
+    std::size_t followers(0);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        followers = m_flights[key].followers;
+        m_flights.erase(key);
+    }
+
+    // Without followers, nothing else can reference the result, so it may be
+    // moved out rather than copied.
+    const Shared result(future.get());
+    if (!followers) return std::move(*result);
+    return *result;
+}
+
+Json::Value IoScheduler::toJson() const
+{
+    Json::Value json;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& p : m_roots)
+    {
+        const Stats& stats(p.second->stats);
+
+        Json::Value& j(json[p.first]);
+        j["requests"] = static_cast<Json::UInt64>(stats.requests);
+        j["failures"] = static_cast<Json::UInt64>(stats.failures);
+        j["coalesced"] = static_cast<Json::UInt64>(stats.coalesced);
+        j["bytesRead"] = static_cast<Json::UInt64>(stats.bytesRead);
+        j["bytesWritten"] = static_cast<Json::UInt64>(stats.bytesWritten);
+        j["seconds"] = stats.seconds;
+    }
+
+    return json;
+}
+
+} // namespace entwine
@@ -0,0 +1,173 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <json/json.h>
+
+namespace entwine
+{
+
+// GETs take priority over PUTs, so that reads of sleeping nodes, which block
+// the insertion of points, are not queued behind background serialization.
+// A PUT which has been queued for long enough is served ahead of them, so
+// that a steady stream of GETs can't starve it.
+enum class IoMethod
+{
+    Get,
+    Put
+};
+
+// Schedules the storage requests of the whole process, per endpoint root.
+// Each root has a limit on its concurrent requests.  Requests are performed
+// by our own threads, and failed requests are queued for retry after a
+// jittered exponential backoff, during which they hold neither a slot nor a
+// thread.  Concurrent GETs of identical data are coalesced into one request,
+// unless a PUT to the same path might have changed that data.
+class IoScheduler
+{
+public:
+    static IoScheduler& instance();
+    ~IoScheduler();
+
+    // Maximum number of concurrent requests per endpoint root, or 0 for no
+    // limit.
+    void setConcurrency(std::size_t n);
+    std::size_t concurrency() const;
+
+    // Performs a request for _path_, relative to its root, which returns
+    // false or throws on failure and sets its argument to the number of bytes
+    // transferred on success.
+    using Attempt = std::function<bool(uint64_t& bytes)>;
+
+    // Queue _attempt_, returning a future which is ready once it succeeds,
+    // or which throws once its retries are exhausted.  Anything referenced by
+    // _attempt_ must remain valid until then.
+    std::shared_future<void> submit(
+            const std::string& root,
+            IoMethod method,
+            const std::string& path,
+            const Attempt& attempt);
+
+    // Submit _attempt_ and wait for it.
+    void run(
+            const std::string& root,
+            IoMethod method,
+            const std::string& path,
+            const Attempt& attempt);
+
+    // Returns the result of _get_, which reads the given _range_ of _path_,
+    // or if an identical GET is already in flight, waits for and shares its
+    // result instead.  A GET which began before a PUT to _path_ completed is
+    // never shared.
+    std::vector<char> coalesce(
+            const std::string& root,
+            const std::string& path,
+            const std::string& range,
+            const std::function<std::vector<char>()>& get);
+
+    // Request counts, bytes transferred, and time spent in requests, per root.
+    Json::Value toJson() const;
+
+private:
+    IoScheduler() { }
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats
+    {
+        uint64_t requests = 0;
+        uint64_t failures = 0;
+        uint64_t coalesced = 0;
+        uint64_t bytesRead = 0;
+        uint64_t bytesWritten = 0;
+        double seconds = 0;
+    };
+
+    struct Request
+    {
+        std::string root;
+        IoMethod method;
+        std::string path;
+        Attempt attempt;
+
+        std::size_t tried = 0;
+        Clock::time_point queued;
+        std::promise<void> promise;
+    };
+
+    using Pending = std::shared_ptr<Request>;
+
+    struct Root
+    {
+        std::size_t active = 0;
+        std::deque<Pending> gets;
+        std::deque<Pending> puts;
+
+        // Failed requests, by the time at which they may be retried.
+        std::multimap<Clock::time_point, Pending> delayed;
+
+        Stats stats;
+    };
+
+    using Shared = std::shared_ptr<std::vector<char>>;
+
+    struct Flight
+    {
+        std::shared_future<Shared> future;
+        std::size_t followers = 0;
+
+        // Set if a PUT to this path was queued or completed since our GET
+        // began, after which the GET may not be shared.
+        bool stale = false;
+    };
+
+    // These are called with our lock held.
+    Root& root(const std::string& name);
+    Pending next(Clock::time_point& wake);
+    std::size_t dispatchable() const;
+    void finish(Root& r, Pending req, bool done, uint64_t bytes, double s);
+    void invalidate(const std::string& path);
+
+    void work();
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::atomic_size_t m_concurrency { 0 };
+    std::map<std::string, std::unique_ptr<Root>> m_roots;
+    std::map<std::string, Flight> m_flights;
+
+    // Queued or active PUTs, by their root and path.
+    std::map<std::string, std::size_t> m_writes;
+
+    std::vector<std::thread> m_threads;
+    std::size_t m_idle = 0;
+    bool m_stop = false;
+
+    IoScheduler(const IoScheduler&);
+    IoScheduler& operator=(const IoScheduler&);
+};
+
+} // namespace entwine
@@ -0,0 +1,174 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/io/spatial.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace entwine
+{
+
+namespace
+{
+
+// Bits per dimension which fit, interleaved, in a 64-bit code.
+const unsigned mortonBits(21);
+
+int64_t getAs(const char* pos, const DimType type)
+{
+    switch (type)
+    {
+        case DimType::Signed8:
+            { int8_t v; std::memcpy(&v, pos, 1); return v; }
+        case DimType::Signed16:
+            { int16_t v; std::memcpy(&v, pos, 2); return v; }
+        case DimType::Signed32:
+            { int32_t v; std::memcpy(&v, pos, 4); return v; }
+        case DimType::Signed64:
+            { int64_t v; std::memcpy(&v, pos, 8); return v; }
+        case DimType::Unsigned8:
+            { uint8_t v; std::memcpy(&v, pos, 1); return v; }
+        case DimType::Unsigned16:
+            { uint16_t v; std::memcpy(&v, pos, 2); return v; }
+        case DimType::Unsigned32:
+            { uint32_t v; std::memcpy(&v, pos, 4); return v; }
+        case DimType::Unsigned64:
+            { uint64_t v; std::memcpy(&v, pos, 8); return v; }
+        default:
+            throw std::runtime_error("Spatial output requires integral XYZ");
+    }
+}
+
+// Spread the low 21 bits of _v_ so that two zero bits follow each one.
+uint64_t spread(uint64_t v)
+{
+    v &= 0x1FFFFF;
+    v = (v | v << 32) & 0x1F00000000FFFFULL;
+    v = (v | v << 16) & 0x1F0000FF0000FFULL;
+    v = (v | v << 8) & 0x100F00F00F00F00FULL;
+    v = (v | v << 4) & 0x10C30C30C30C30C3ULL;
+    v = (v | v << 2) & 0x1249249249249249ULL;
+    return v;
+}
+
+unsigned bitsFor(uint64_t v)
+{
+    unsigned bits(0);
+    while (v) { ++bits; v >>= 1; }
+    return bits;
+}
+
+} // unnamed namespace
+
+Spatial::Spatial(const Metadata& m)
+    : Columnar(m)
+{
+    if (!m.outSchema().isScaled())
+    {
+        throw std::runtime_error("Spatial output requires scaling.");
+    }
+}
+
+void Spatial::sort(std::vector<char>& packed, const Bounds& bounds) const
+{
+    const Schema& outSchema(m_metadata.outSchema());
+    const std::size_t pointSize(outSchema.pointSize());
+    const uint64_t np(packed.size() / pointSize);
+    if (np < 2) return;
+
+    // Positions and types of XYZ within the packed layout.
+    std::size_t pos[3];
+    DimType types[3];
+
+    std::size_t offset(0);
+    for (const DimInfo& d : outSchema.dims())
+    {
+        const int i(
+                d.id() == DimId::X ? 0 :
+                d.id() == DimId::Y ? 1 :
+                d.id() == DimId::Z ? 2 : -1);
+
+        if (i >= 0)
+        {
+            pos[i] = offset;
+            types[i] = d.type();
+        }
+
+        offset += d.size();
+    }
+
+    // Quantized positions relative to the minimum of this node, shifted if
+    // necessary so that the largest extent fits within our Morton code.
+    std::vector<int64_t> xyz(np * 3);
+    int64_t mins[3] = {
+        std::numeric_limits<int64_t>::max(),
+        std::numeric_limits<int64_t>::max(),
+        std::numeric_limits<int64_t>::max()
+    };
+    int64_t maxs[3] = {
+        std::numeric_limits<int64_t>::lowest(),
+        std::numeric_limits<int64_t>::lowest(),
+        std::numeric_limits<int64_t>::lowest()
+    };
+
+    for (uint64_t p(0); p < np; ++p)
+    {
+        for (std::size_t i(0); i < 3; ++i)
+        {
+            const int64_t v(
+                    getAs(packed.data() + p * pointSize + pos[i], types[i]));
+            xyz[p * 3 + i] = v;
+            mins[i] = std::min(mins[i], v);
+            maxs[i] = std::max(maxs[i], v);
+        }
+    }
+
+    unsigned bits(0);
+    for (std::size_t i(0); i < 3; ++i)
+    {
+        bits = std::max(
+                bits,
+                bitsFor(static_cast<uint64_t>(maxs[i]) -
+                    static_cast<uint64_t>(mins[i])));
+    }
+    const unsigned shift(bits > mortonBits ? bits - mortonBits : 0);
+
+    std::vector<std::pair<uint64_t, uint64_t>> codes(np);
+    for (uint64_t p(0); p < np; ++p)
+    {
+        uint64_t code(0);
+        for (std::size_t i(0); i < 3; ++i)
+        {
+            const uint64_t q(
+                    (static_cast<uint64_t>(xyz[p * 3 + i]) -
+                     static_cast<uint64_t>(mins[i])) >> shift);
+            code |= spread(q) << i;
+        }
+
+        codes[p] = std::make_pair(code, p);
+    }
+
+    std::sort(codes.begin(), codes.end());
+
+    std::vector<char> sorted(packed.size());
+    for (uint64_t p(0); p < np; ++p)
+    {
+        const char* from(packed.data() + codes[p].second * pointSize);
+        std::copy(from, from + pointSize, sorted.data() + p * pointSize);
+    }
+
+    packed = std::move(sorted);
+}
+
+} // namespace entwine
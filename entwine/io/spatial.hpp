@@ -0,0 +1,35 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <entwine/io/columnar.hpp>
+
+namespace entwine
+{
+
+// The columnar format, with the points of each node sorted by the Morton
+// code of their quantized positions.  Consecutive points are then spatially
+// adjacent, so the XYZ columns reduce to small bit-packed residuals.  Readers
+// are unaffected by the ordering.
+class Spatial : public Columnar
+{
+public:
+    Spatial(const Metadata& m);
+
+    virtual std::string type() const override { return "spatial"; }
+
+protected:
+    virtual void sort(
+            std::vector<char>& packed,
+            const Bounds& bounds) const override;
+};
+
+} // namespace entwine
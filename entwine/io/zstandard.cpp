@@ -10,54 +10,325 @@
 
 #include <entwine/io/zstandard.hpp>
 
-/*
-#include <pdal/compression/ZstdCompression.hpp>
+#ifdef ENTWINE_HAVE_ZSTD
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <zdict.h>
+#include <zstd.h>
+
+#include <entwine/util/unique.hpp>
 
 namespace entwine
 {
 
+namespace
+{
+    const int defaultLevel(3);
+
+    // Dictionary training parameters.  Samples are truncated so that the
+    // largest nodes don't dominate the training set.
+    const std::size_t dictionarySize(112640);
+    const std::size_t maxSampleSize(131072);
+    const std::size_t trainingSize(dictionarySize * 100);
+
+    std::string dictionaryFilename(const unsigned id)
+    {
+        return "dictionary-" + std::to_string(id) + ".zdict";
+    }
+
+    std::size_t check(const std::size_t code, const std::string& what)
+    {
+        if (ZSTD_isError(code))
+        {
+            throw std::runtime_error(
+                    "Zstandard " + what + " failed: " +
+                    ZSTD_getErrorName(code));
+        }
+        return code;
+    }
+
+    using CompressionContext =
+        std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)>;
+    using DecompressionContext =
+        std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)>;
+}
+
+class Zstandard::Dictionary
+{
+public:
+    Dictionary(std::vector<char> data, const int level)
+        : m_data(std::move(data))
+        , m_id(ZSTD_getDictID_fromDict(m_data.data(), m_data.size()))
+        , m_cdict(ZSTD_createCDict(m_data.data(), m_data.size(), level))
+        , m_ddict(ZSTD_createDDict(m_data.data(), m_data.size()))
+    {
+        if (!m_id || !m_cdict || !m_ddict)
+        {
+            ZSTD_freeCDict(m_cdict);
+            ZSTD_freeDDict(m_ddict);
+            throw std::runtime_error("Invalid Zstandard dictionary");
+        }
+    }
+
+    ~Dictionary()
+    {
+        ZSTD_freeCDict(m_cdict);
+        ZSTD_freeDDict(m_ddict);
+    }
+
+    const std::vector<char>& data() const { return m_data; }
+    unsigned id() const { return m_id; }
+    const ZSTD_CDict* cdict() const { return m_cdict; }
+    const ZSTD_DDict* ddict() const { return m_ddict; }
+
+private:
+    const std::vector<char> m_data;
+    const unsigned m_id;
+    ZSTD_CDict* m_cdict;
+    ZSTD_DDict* m_ddict;
+
+    Dictionary(const Dictionary&);
+    Dictionary& operator=(const Dictionary&);
+};
+
+Zstandard::Zstandard(const Metadata& m, const Json::Value& options)
+    : Binary(m)
+    , m_level(options.isMember("level") ?
+            options["level"].asInt() : defaultLevel)
+    , m_train(options["dictionary"].asBool())
+    , m_dictionaryId(options["dictionaryId"].asUInt())
+{
+    if (m_level < ZSTD_minCLevel() || m_level > ZSTD_maxCLevel())
+    {
+        throw std::runtime_error(
+                "Invalid Zstandard level: " + std::to_string(m_level));
+    }
+}
+
+Zstandard::~Zstandard() { }
+
+Json::Value Zstandard::options() const
+{
+    Json::Value json;
+    json["level"] = m_level;
+    if (m_train) json["dictionary"] = true;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_dictionaryId) json["dictionaryId"] = m_dictionaryId;
+
+    return json;
+}
+
 void Zstandard::write(
         const arbiter::Endpoint& out,
         const arbiter::Endpoint& tmp,
-        PointPool& pointPool,
         const std::string& filename,
-        Cell::PooledStack&& cells,
-        const uint64_t np) const
+        const Bounds& bounds,
+        BlockPointTable& src) const
 {
-    const auto uncompressed(getBuffer(cells, np));
+    const std::vector<char> packed(pack(src));
+    const SharedDictionary dictionary(active(out, packed));
 
-    std::vector<char> compressed;
-    pdal::ZstdCompressor compressor([&compressed](char* pos, std::size_t size)
-    {
-        compressed.insert(compressed.end(), pos, pos + size);
-    });
+    CompressionContext ctx(ZSTD_createCCtx(), ZSTD_freeCCtx);
+    if (!ctx) throw std::runtime_error("Could not create Zstandard context");
+
+    std::vector<char> compressed(ZSTD_compressBound(packed.size()));
 
-    compressor.compress(uncompressed.data(), uncompressed.size());
-    compressor.done();
+    const std::size_t size(
+            check(
+                dictionary ?
+                    ZSTD_compress_usingCDict(
+                        ctx.get(),
+                        compressed.data(),
+                        compressed.size(),
+                        packed.data(),
+                        packed.size(),
+                        dictionary->cdict()) :
+                    ZSTD_compressCCtx(
+                        ctx.get(),
+                        compressed.data(),
+                        compressed.size(),
+                        packed.data(),
+                        packed.size(),
+                        m_level),
+                "compression"));
 
-    writeBuffer(out, filename + ".zst", compressed);
+    compressed.resize(size);
+    store(out, tmp, filename + ".zst", compressed);
 }
 
-Cell::PooledStack Zstandard::read(
+void Zstandard::read(
         const arbiter::Endpoint& out,
         const arbiter::Endpoint& tmp,
-        PointPool& pool,
-        const std::string& filename) const
+        const std::string& filename,
+        VectorPointTable& dst) const
+{
+    const std::vector<char> compressed(fetch(out, tmp, filename + ".zst"));
+
+    DecompressionContext ctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    if (!ctx) throw std::runtime_error("Could not create Zstandard context");
+
+    const unsigned id(
+            ZSTD_getDictID_fromFrame(compressed.data(), compressed.size()));
+
+    SharedDictionary dictionary;
+    if (id)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        dictionary = get(out, id);
+    }
+
+    if (dictionary)
+    {
+        check(ZSTD_DCtx_refDDict(ctx.get(), dictionary->ddict()), "init");
+    }
+
+    // Decompress a batch at a time directly into the tail end of the
+    // destination buffer, and then unpack each batch in place to the front.
+    const std::size_t srcPointSize(m_metadata.outSchema().pointSize());
+    const std::size_t dstPointSize(m_metadata.schema().pointSize());
+    const std::size_t capacity(dst.capacity());
+
+    char* const begin(dst.getPoint(0));
+    char* const tail(begin + capacity * (dstPointSize - srcPointSize));
+
+    ZSTD_inBuffer in { compressed.data(), compressed.size(), 0 };
+    std::size_t remaining(1);
+
+    while (remaining)
+    {
+        ZSTD_outBuffer o { tail, capacity * srcPointSize, 0 };
+
+        while (remaining && o.pos < o.size)
+        {
+            remaining = check(
+                    ZSTD_decompressStream(ctx.get(), &o, &in),
+                    "decompression");
+
+            if (remaining && o.pos < o.size && in.pos == in.size)
+            {
+                throw std::runtime_error("Truncated data: " + filename);
+            }
+        }
+
+        if (o.pos % srcPointSize)
+        {
+            throw std::runtime_error("Invalid data size: " + filename);
+        }
+
+        if (const uint64_t np = o.pos / srcPointSize)
+        {
+            unpack(tail, begin, np);
+            dst.clear(np);
+        }
+    }
+}
+
+std::vector<char> Zstandard::compress(
+        const char* data,
+        const std::size_t size,
+        const int level)
+{
+    CompressionContext ctx(ZSTD_createCCtx(), ZSTD_freeCCtx);
+    if (!ctx) throw std::runtime_error("Could not create Zstandard context");
+
+    std::vector<char> compressed(ZSTD_compressBound(size));
+    compressed.resize(
+            check(
+                ZSTD_compressCCtx(
+                    ctx.get(),
+                    compressed.data(),
+                    compressed.size(),
+                    data,
+                    size,
+                    level),
+                "compression"));
+    return compressed;
+}
+
+Zstandard::SharedDictionary Zstandard::active(
+        const arbiter::Endpoint& out,
+        const std::vector<char>& packed) const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (m_dictionaryId) return get(out, m_dictionaryId);
+    if (!m_train || m_training) return SharedDictionary();
+
+    const std::size_t size(std::min(packed.size(), maxSampleSize));
+    if (!size) return SharedDictionary();
+
+    m_samples.insert(m_samples.end(), packed.begin(), packed.begin() + size);
+    m_sampleSizes.push_back(size);
+
+    if (m_samples.size() < trainingSize) return SharedDictionary();
+
+    // We have enough samples - train without blocking other writers, which
+    // will compress without a dictionary in the meantime.
+    m_training = true;
+    lock.unlock();
+    return train(out);
+}
+
+Zstandard::SharedDictionary Zstandard::train(
+        const arbiter::Endpoint& out) const
 {
-    std::vector<char> uncompressed;
-    const auto compressed(getBuffer(out, filename + ".zst"));
+    std::vector<char> data(dictionarySize);
+
+    const std::size_t size(
+            ZDICT_trainFromBuffer(
+                data.data(),
+                data.size(),
+                m_samples.data(),
+                m_sampleSizes.data(),
+                m_sampleSizes.size()));
 
-    pdal::ZstdDecompressor dec([&uncompressed](char* pos, std::size_t size)
+    SharedDictionary dictionary;
+
+    if (!ZDICT_isError(size))
     {
-        uncompressed.insert(uncompressed.end(), pos, pos + size);
-    });
+        data.resize(size);
+        dictionary = std::make_shared<Dictionary>(std::move(data), m_level);
+        const std::string filename(dictionaryFilename(dictionary->id()));
+        ensurePut(out, filename, dictionary->data());
+    }
 
-    dec.decompress(compressed.data(), compressed.size());
-    dec.done();
+    // If training failed, just continue without a dictionary.
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (dictionary)
+    {
+        m_dictionaryId = dictionary->id();
+        m_dictionaries[m_dictionaryId] = dictionary;
+    }
+
+    m_samples = std::vector<char>();
+    m_sampleSizes = std::vector<std::size_t>();
+
+    return dictionary;
+}
+
+Zstandard::SharedDictionary Zstandard::get(
+        const arbiter::Endpoint& out,
+        const unsigned id) const
+{
+    auto it(m_dictionaries.find(id));
+    if (it != m_dictionaries.end()) return it->second;
+
+    const auto data(ensureGet(out, dictionaryFilename(id)));
+    SharedDictionary dictionary(
+            std::make_shared<Dictionary>(std::move(*data), m_level));
+
+    if (dictionary->id() != id)
+    {
+        throw std::runtime_error("Mismatched Zstandard dictionary ID");
+    }
 
-    return getCells(pool, uncompressed);
+    m_dictionaries[id] = dictionary;
+    return dictionary;
 }
 
 } // namespace entwine
-*/
 
+#endif
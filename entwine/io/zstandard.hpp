@@ -8,34 +8,80 @@
 *
 ******************************************************************************/
 
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
 #include <entwine/io/binary.hpp>
 
-/*
 namespace entwine
 {
 
+// Stores the native binary layout of the output schema, compressed with
+// Zstandard.  If the "dictionary" option is set, a dictionary is trained from
+// the first nodes written and then used for all subsequent nodes.  Since each
+// frame records the ID of its dictionary, nodes written before training are
+// still readable, as are those written by other builders of the same output.
 class Zstandard : public Binary
 {
 public:
-    Zstandard(const Metadata& m) : Binary(m) { }
+    Zstandard(const Metadata& m, const Json::Value& options);
+    ~Zstandard();
 
     virtual std::string type() const override { return "zstandard"; }
+    virtual std::string extension() const override { return ".zst"; }
+    virtual Json::Value options() const override;
 
     virtual void write(
             const arbiter::Endpoint& out,
             const arbiter::Endpoint& tmp,
-            PointPool& pointPool,
             const std::string& filename,
-            Cell::PooledStack&& cells,
-            uint64_t np) const override;
+            const Bounds& bounds,
+            BlockPointTable& table) const override;
 
-    virtual Cell::PooledStack read(
+    virtual void read(
             const arbiter::Endpoint& out,
             const arbiter::Endpoint& tmp,
-            PointPool& pointPool,
-            const std::string& filename) const override;
+            const std::string& filename,
+            VectorPointTable& table) const override;
+
+    // Compress _size_ bytes at _data_ as a single frame, without a
+    // dictionary.
+    static std::vector<char> compress(
+            const char* data,
+            std::size_t size,
+            int level);
+
+private:
+    class Dictionary;
+    using SharedDictionary = std::shared_ptr<const Dictionary>;
+
+    // Get the dictionary with which to compress, if one is available.  While
+    // training, the packed data is retained as a training sample.
+    SharedDictionary active(
+            const arbiter::Endpoint& out,
+            const std::vector<char>& packed) const;
+
+    SharedDictionary train(const arbiter::Endpoint& out) const;
+
+    // Get a dictionary by ID, fetching it from the output if needed.  The
+    // mutex must be held by the caller.
+    SharedDictionary get(const arbiter::Endpoint& out, unsigned id) const;
+
+    const int m_level;
+    const bool m_train;
+
+    mutable std::mutex m_mutex;
+    mutable std::map<unsigned, SharedDictionary> m_dictionaries;
+    mutable unsigned m_dictionaryId = 0;
+    mutable bool m_training = false;
+
+    mutable std::vector<char> m_samples;
+    mutable std::vector<std::size_t> m_sampleSizes;
 };
 
 } // namespace entwine
-*/
-
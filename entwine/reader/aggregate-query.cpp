@@ -0,0 +1,322 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/reader/aggregate-query.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <entwine/reader/reader.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    // The bin of [0, n) into which _v_ falls, where values beyond the range
+    // are clamped into the outermost bins.
+    std::size_t binOf(
+            const double v,
+            const double min,
+            const double width,
+            const std::size_t n)
+    {
+        const double b(std::floor((v - min) / width));
+        if (!(b > 0)) return 0;
+        return std::min<std::size_t>(static_cast<std::size_t>(b), n - 1);
+    }
+}
+
+void AggregateQuery::Summary::add(const Summary& other)
+{
+    count += other.count;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    sum += other.sum;
+}
+
+AggregateQuery::AggregateQuery(const Reader& reader, const Json::Value& json)
+    : Query(reader, json)
+    , m_x(column("X"))
+    , m_y(column("Y"))
+{
+    for (const Json::Value& name : json["stats"])
+    {
+        m_stats.push_back(column(name.asString()));
+    }
+
+    const Json::Value& histograms(json["histograms"]);
+    for (const std::string& name : histograms.getMemberNames())
+    {
+        const Json::Value& h(histograms[name]);
+
+        Histogram histogram;
+        histogram.column = column(name);
+        histogram.min = h["min"].asDouble();
+        histogram.max = h["max"].asDouble();
+        histogram.bins = h["bins"].asUInt64();
+
+        if (!histogram.bins || !(histogram.max > histogram.min))
+        {
+            throw std::runtime_error(
+                    "Invalid histogram: " + h.toStyledString());
+        }
+
+        m_histograms.push_back(histogram);
+    }
+
+    if (json.isMember("grid"))
+    {
+        const Json::Value& g(json["grid"]);
+        m_width = g["width"].asUInt64();
+        m_height = g["height"].asUInt64();
+
+        if (!m_width || !m_height)
+        {
+            throw std::runtime_error("Invalid grid: " + g.toStyledString());
+        }
+
+        m_gridBounds = json.isMember("bounds") ?
+            Bounds(json["bounds"]) : m_metadata.boundsConforming();
+    }
+
+    m_result = blank();
+}
+
+AggregateQuery::Column AggregateQuery::column(const std::string& name) const
+{
+    const auto id(m_metadata.schema().getId(name));
+    if (id == pdal::Dimension::Id::Unknown)
+    {
+        throw std::runtime_error("Unknown dimension: " + name);
+    }
+
+    const pdal::PointLayout& layout(m_metadata.schema().pdalLayout());
+
+    Column c;
+    c.name = name;
+    c.pos = layout.dimOffset(id);
+    c.type = layout.dimType(id);
+    return c;
+}
+
+std::set<std::string> AggregateQuery::dims() const
+{
+    std::set<std::string> result(Query::dims());
+    for (const Column& c : m_stats) result.insert(c.name);
+    for (const Histogram& h : m_histograms) result.insert(h.column.name);
+    return result;
+}
+
+AggregateQuery::Partial& AggregateQuery::partial() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto id(std::this_thread::get_id());
+    auto it(m_partials.find(id));
+    if (it != m_partials.end()) return it->second;
+
+    return m_partials[id] = blank();
+}
+
+AggregateQuery::Partial AggregateQuery::blank() const
+{
+    Partial p;
+    p.stats.resize(m_stats.size());
+    for (const Histogram& h : m_histograms) p.histograms.emplace_back(h.bins);
+    p.grid.resize(m_width * m_height);
+    return p;
+}
+
+void AggregateQuery::run()
+{
+    m_partials.clear();
+    Query::run();
+
+    m_result = blank();
+
+    for (const auto& p : m_partials)
+    {
+        const Partial& partial(p.second);
+
+        for (std::size_t i(0); i < m_stats.size(); ++i)
+        {
+            m_result.stats[i].add(partial.stats[i]);
+        }
+
+        for (std::size_t i(0); i < m_histograms.size(); ++i)
+        {
+            auto& dst(m_result.histograms[i]);
+            const auto& src(partial.histograms[i]);
+            for (std::size_t b(0); b < dst.size(); ++b) dst[b] += src[b];
+        }
+
+        for (std::size_t i(0); i < m_result.grid.size(); ++i)
+        {
+            m_result.grid[i] += partial.grid[i];
+        }
+    }
+
+    m_partials.clear();
+}
+
+bool AggregateQuery::reduce(const std::vector<const char*>& points) const
+{
+    Partial& p(partial());
+    thread_local std::vector<double> values;
+
+    for (std::size_t i(0); i < m_stats.size(); ++i)
+    {
+        const Column& c(m_stats[i]);
+        readColumn(points, c.pos, c.type, values);
+
+        Summary& s(p.stats[i]);
+        s.count += values.size();
+        for (const double v : values)
+        {
+            s.min = std::min(s.min, v);
+            s.max = std::max(s.max, v);
+            s.sum += v;
+        }
+    }
+
+    for (std::size_t i(0); i < m_histograms.size(); ++i)
+    {
+        const Histogram& h(m_histograms[i]);
+        readColumn(points, h.column.pos, h.column.type, values);
+
+        std::vector<uint64_t>& bins(p.histograms[i]);
+        const double width((h.max - h.min) / h.bins);
+        for (const double v : values) ++bins[binOf(v, h.min, width, h.bins)];
+    }
+
+    if (!p.grid.empty())
+    {
+        thread_local std::vector<double> x, y;
+        readColumn(points, m_x.pos, m_x.type, x);
+        readColumn(points, m_y.pos, m_y.type, y);
+
+        const Point& min(m_gridBounds.min());
+        const double cw(m_gridBounds.width() / m_width);
+        const double ch(m_gridBounds.depth() / m_height);
+
+        for (std::size_t i(0); i < points.size(); ++i)
+        {
+            const std::size_t col(binOf(x[i], min.x, cw, m_width));
+            const std::size_t row(binOf(y[i], min.y, ch, m_height));
+            ++p.grid[row * m_width + col];
+        }
+    }
+
+    return true;
+}
+
+bool AggregateQuery::summarize(const Dxyz& key, const uint64_t count) const
+{
+    if (!m_histograms.empty() || m_width) return false;
+    if (m_stats.empty()) return true;
+
+    const auto stats(m_hierarchy.stats(key));
+    if (!stats) return false;
+
+    std::vector<Summary> summaries;
+    for (const Column& c : m_stats)
+    {
+        const NodeStats::Dim* d(stats->find(c.name));
+        if (!d) return false;
+
+        Summary s;
+        s.count = count;
+        s.min = d->min;
+        s.max = d->max;
+        s.sum = d->sum;
+        summaries.push_back(s);
+    }
+
+    Partial& p(partial());
+    for (std::size_t i(0); i < summaries.size(); ++i)
+    {
+        p.stats[i].add(summaries[i]);
+    }
+
+    return true;
+}
+
+const std::vector<uint64_t>& AggregateQuery::histogram(
+        const std::string& name) const
+{
+    for (std::size_t i(0); i < m_histograms.size(); ++i)
+    {
+        if (m_histograms[i].column.name == name)
+        {
+            return m_result.histograms.at(i);
+        }
+    }
+
+    throw std::runtime_error("No histogram was requested for " + name);
+}
+
+Json::Value AggregateQuery::toJson() const
+{
+    Json::Value json;
+    json["points"] = static_cast<Json::UInt64>(points());
+    json["done"] = done();
+    json["satisfied"] = static_cast<Json::UInt64>(satisfied());
+
+    for (std::size_t i(0); i < m_stats.size(); ++i)
+    {
+        const Summary& s(m_result.stats[i]);
+        Json::Value& j(json["stats"][m_stats[i].name]);
+        j["count"] = static_cast<Json::UInt64>(s.count);
+
+        if (s.count)
+        {
+            j["min"] = s.min;
+            j["max"] = s.max;
+            j["mean"] = s.sum / s.count;
+        }
+    }
+
+    for (std::size_t i(0); i < m_histograms.size(); ++i)
+    {
+        const Histogram& h(m_histograms[i]);
+        Json::Value& j(json["histograms"][h.column.name]);
+        j["min"] = h.min;
+        j["max"] = h.max;
+
+        Json::Value& bins(j["bins"]);
+        bins = Json::arrayValue;
+        for (const uint64_t n : m_result.histograms[i])
+        {
+            bins.append(static_cast<Json::UInt64>(n));
+        }
+    }
+
+    if (m_width)
+    {
+        Json::Value& j(json["grid"]);
+        j["bounds"] = m_gridBounds.toJson();
+        j["width"] = static_cast<Json::UInt64>(m_width);
+        j["height"] = static_cast<Json::UInt64>(m_height);
+
+        Json::Value& counts(j["counts"]);
+        counts = Json::arrayValue;
+        for (const uint64_t n : m_result.grid)
+        {
+            counts.append(static_cast<Json::UInt64>(n));
+        }
+    }
+
+    return json;
+}
+
+} // namespace entwine
+
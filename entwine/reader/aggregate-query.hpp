@@ -0,0 +1,131 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <json/json.h>
+
+#include <entwine/reader/query.hpp>
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/defs.hpp>
+
+namespace entwine
+{
+
+// Reduces the selected points within the reader rather than returning them.
+// Any of the following may be requested along with the usual query
+// parameters:
+//
+//      {
+//          "stats": ["Z", "Intensity"],
+//          "histograms": {
+//              "Intensity": { "min": 0, "max": 65536, "bins": 256 }
+//          },
+//          "grid": { "width": 512, "height": 512 }
+//      }
+//
+// Stats are the minimum, maximum, and mean of each dimension.  Histogram
+// bins are of equal width over [min, max), with values outside of this range
+// counted in the first or last bin.  The density grid counts the points
+// falling in each cell of the query bounds, or of the conforming bounds of
+// the index if the query is unbounded, in row-major order from the minimum
+// corner.
+//
+// Nodes are reduced concurrently into per-thread partial results which are
+// merged once the query has run.  If only stats are requested, nodes whose
+// points are all selected are summarized from their recorded statistics
+// without being read.
+class AggregateQuery : public Query
+{
+public:
+    AggregateQuery(const Reader& reader, const Json::Value& json);
+
+    virtual void run() override;
+
+    // The density grid, in row-major order, which is empty if no grid was
+    // requested.
+    const std::vector<uint64_t>& grid() const { return m_result.grid; }
+
+    // The histogram of _name_, which must have been requested.
+    const std::vector<uint64_t>& histogram(const std::string& name) const;
+
+    Json::Value toJson() const;
+
+protected:
+    virtual bool reduce(const std::vector<const char*>& points) const
+        override;
+    virtual bool summarize(const Dxyz& key, uint64_t count) const override;
+    virtual std::set<std::string> dims() const override;
+
+private:
+    struct Column
+    {
+        std::string name;
+        std::size_t pos = 0;
+        DimType type = DimType::None;
+    };
+
+    struct Summary
+    {
+        uint64_t count = 0;
+        double min = std::numeric_limits<double>::max();
+        double max = std::numeric_limits<double>::lowest();
+        double sum = 0;
+
+        void add(const Summary& other);
+    };
+
+    struct Histogram
+    {
+        Column column;
+        double min = 0;
+        double max = 0;
+        std::size_t bins = 0;
+    };
+
+    struct Partial
+    {
+        std::vector<Summary> stats;
+        std::vector<std::vector<uint64_t>> histograms;
+        std::vector<uint64_t> grid;
+    };
+
+    Column column(const std::string& name) const;
+
+    // The partial result of the calling thread.
+    Partial& partial() const;
+    Partial blank() const;
+
+    std::vector<Column> m_stats;
+    std::vector<Histogram> m_histograms;
+
+    Bounds m_gridBounds;
+    std::size_t m_width = 0;
+    std::size_t m_height = 0;
+    Column m_x;
+    Column m_y;
+
+    mutable std::mutex m_mutex;
+    mutable std::map<std::thread::id, Partial> m_partials;
+    Partial m_result;
+};
+
+} // namespace entwine
+
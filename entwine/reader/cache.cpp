@@ -10,80 +10,260 @@
 
 #include <entwine/reader/cache.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <initializer_list>
+
 #include <entwine/reader/reader.hpp>
+#include <entwine/util/unique.hpp>
 
 namespace entwine
 {
 
+namespace
+{
+    // The cost of a chunk at depth zero is scaled by 1 + shallowWeight,
+    // falling toward 1 with depth.
+    const double shallowWeight(4);
+
+    // Chunks which load instantly, for example from a local disk cache, must
+    // still be preferred by size.
+    const double minCost(1e-6);
+
+    std::size_t hashOf(const GlobalId& id)
+    {
+        const std::hash<uint64_t> h;
+        const Dxyz& k(id.key);
+
+        std::size_t v(h(id.dataset));
+        for (const uint64_t n : { k.d, k.p.x, k.p.y, k.p.z })
+        {
+            v ^= h(n) + 0x9e3779b9 + (v << 6) + (v >> 2);
+        }
+        return v;
+    }
+}
+
 bool operator<(const GlobalId& a, const GlobalId& b)
 {
-    return a.path < b.path || (a.path == b.path && a.key < b.key);
+    return a.dataset < b.dataset ||
+        (a.dataset == b.dataset && a.key < b.key);
 }
 
-std::deque<SharedChunkReader> Cache::acquire(
-        const Reader& reader,
-        const std::vector<Dxyz>& keys)
+Cache::Cache(const std::size_t maxBytes, const std::size_t shards)
+    : m_maxBytes(maxBytes)
 {
-    std::deque<SharedChunkReader> block;
+    for (std::size_t i(0); i < std::max<std::size_t>(shards, 1); ++i)
+    {
+        m_shards.push_back(makeUnique<Shard>());
+    }
+}
+
+std::shared_ptr<Cache> Cache::global()
+{
+    static std::shared_ptr<Cache> cache(std::make_shared<Cache>());
+    return cache;
+}
 
-    std::lock_guard<std::mutex> lock(m_mutex);
-    for (const Dxyz& key : keys) block.push_back(get(reader, key));
+void Cache::setMaxBytes(const std::size_t maxBytes)
+{
+    m_maxBytes = maxBytes;
 
-    purge();
+    for (auto& s : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        purge(*s);
+    }
+}
 
+uint64_t Cache::attach()
+{
+    return m_datasets++;
+}
+
+void Cache::detach(const uint64_t dataset)
+{
+    for (auto& s : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(s->mutex);
+
+        auto it(s->chunks.lower_bound(GlobalId(dataset, Dxyz())));
+        while (it != s->chunks.end() && it->first.dataset == dataset)
+        {
+            ChunkReaderInfo& info(it->second);
+            if (!info.loaded)
+            {
+                ++it;
+                continue;
+            }
+
+            s->size -= info.bytes;
+            s->order.erase(info.it);
+            it = s->chunks.erase(it);
+        }
+    }
+}
+
+Cache::Shard& Cache::shard(const GlobalId& id)
+{
+    return *m_shards[hashOf(id) % m_shards.size()];
+}
+
+std::deque<SharedChunkReader> Cache::acquire(
+        const Reader& reader,
+        const std::vector<Dxyz>& keys,
+        const std::set<std::string>& dims)
+{
+    std::deque<SharedChunkReader> block;
+    for (const Dxyz& key : keys) block.push_back(get(reader, key, dims));
     return block;
 }
 
-SharedChunkReader Cache::get(const Reader& reader, const Dxyz& key)
+SharedChunkReader Cache::get(
+        const Reader& reader,
+        const Dxyz& key,
+        const std::set<std::string>& dims)
 {
-    const GlobalId id(reader.path(), key);
+    using Clock = std::chrono::steady_clock;
+
+    const GlobalId id(reader.id(), key);
+    Shard& s(shard(id));
 
-    auto it(m_chunks.find(id));
+    std::unique_lock<std::mutex> lock(s.mutex);
+    auto it(s.chunks.find(id));
 
-    if (it == m_chunks.end())
+    if (it == s.chunks.end())
     {
-        // std::cout << "\tAdd " << id.key << std::endl;
-        it = m_chunks.insert(std::make_pair(id, ChunkReaderInfo())).first;
+        ++s.stats.misses;
+
+        std::promise<SharedChunkReader> promise;
+        it = s.chunks.insert(std::make_pair(id, ChunkReaderInfo())).first;
+        it->second.chunk = promise.get_future().share();
+        lock.unlock();
+
+        // Fetch and decode without holding our lock.  Our entry may not be
+        // erased by anyone else while it is loading, so _it_ remains valid.
+        const auto start(Clock::now());
+        SharedChunkReader chunk;
+        try
+        {
+            chunk = std::make_shared<ChunkReader>(reader, key, dims);
+        }
+        catch (...)
+        {
+            lock.lock();
+            s.chunks.erase(it);
+            lock.unlock();
 
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+        const std::chrono::duration<double> elapsed(Clock::now() - start);
+
+        lock.lock();
         ChunkReaderInfo& info(it->second);
-        info.chunk = std::make_shared<ChunkReader>(reader, key);
-        m_size += info.chunk->bytes();
+        info.loaded = true;
+        info.bytes = chunk->bytes();
+        info.cost =
+            std::max(elapsed.count(), minCost) *
+            (1.0 + shallowWeight / (1.0 + key.d));
+
+        info.it = s.order.end();
+        touch(s, it);
+        s.size += info.bytes;
+        purge(s);
+        lock.unlock();
+
+        promise.set_value(chunk);
+        return chunk;
     }
-    else
+
+    ChunkReaderInfo& info(it->second);
+    if (info.loaded)
     {
-        ChunkReaderInfo& info(it->second);
-        m_order.erase(info.it);
+        ++s.stats.hits;
+        ++info.hits;
+        touch(s, it);
     }
+    else ++s.stats.waits;
 
-    m_order.push_front(it);
+    const std::shared_future<SharedChunkReader> future(info.chunk);
+    lock.unlock();
+
+    SharedChunkReader chunk(future.get());
+    chunk->ensure(reader, dims);
+    return chunk;
+}
 
+void Cache::touch(Shard& s, const ChunkReaderInfo::Map::iterator it)
+{
     ChunkReaderInfo& info(it->second);
-    info.it = m_order.begin();
+    if (info.it != s.order.end()) s.order.erase(info.it);
 
-    return info.chunk;
+    const double priority(
+            s.age + (1.0 + info.hits) * info.cost / info.bytes);
+    info.it = s.order.insert(std::make_pair(priority, it));
 }
 
-void Cache::purge()
+void Cache::purge(Shard& s)
 {
-    const std::size_t start(m_size);
-    while (m_size > m_maxBytes)
+    const std::size_t limit(shardBytes());
+
+    while (s.size > limit && !s.order.empty())
     {
-        const auto& it(m_order.back());
-        const GlobalId& id(it->first);
-        const ChunkReaderInfo& info(it->second);
-
-        std::cout << "\tDel " << id.key << std::endl;
-        m_size -= info.chunk->bytes();
-        m_order.pop_back();
-        m_chunks.erase(it);
+        const auto victim(s.order.begin());
+        const ChunkReaderInfo& info(victim->second->second);
+
+        s.age = victim->first;
+        s.size -= info.bytes;
+        ++s.stats.evictions;
+        s.stats.evictedBytes += info.bytes;
+
+        s.chunks.erase(victim->second);
+        s.order.erase(victim);
     }
+}
 
-    if (start > m_size)
+Cache::Stats Cache::stats() const
+{
+    Stats result;
+    for (const auto& s : m_shards)
     {
-        std::cout << "\t\tPurged " << (start - m_size) << std::endl;
-        std::cout << "\t\tLeft " << m_size << std::endl;
+        std::lock_guard<std::mutex> lock(s->mutex);
+        result.hits += s->stats.hits;
+        result.misses += s->stats.misses;
+        result.waits += s->stats.waits;
+        result.evictions += s->stats.evictions;
+        result.evictedBytes += s->stats.evictedBytes;
     }
+    return result;
 }
 
-} // namespace entwine
+std::size_t Cache::size() const
+{
+    std::size_t result(0);
+    for (const auto& s : m_shards)
+    {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        result += s->size;
+    }
+    return result;
+}
+
+Json::Value Cache::toJson() const
+{
+    const Stats s(stats());
+
+    Json::Value json;
+    json["maxBytes"] = static_cast<Json::UInt64>(maxBytes());
+    json["bytes"] = static_cast<Json::UInt64>(size());
+    json["hits"] = static_cast<Json::UInt64>(s.hits);
+    json["misses"] = static_cast<Json::UInt64>(s.misses);
+    json["waits"] = static_cast<Json::UInt64>(s.waits);
+    json["evictions"] = static_cast<Json::UInt64>(s.evictions);
+    json["evictedBytes"] = static_cast<Json::UInt64>(s.evictedBytes);
+    return json;
+}
 
+} // namespace entwine
@@ -10,11 +10,19 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <deque>
-#include <list>
+#include <future>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <json/json.h>
 
 #include <entwine/reader/chunk-reader.hpp>
 #include <entwine/types/key.hpp>
@@ -24,14 +32,16 @@ namespace entwine
 
 class Reader;
 
+// Identifies a chunk of a dataset, where datasets are numbered by the cache
+// as readers are attached to it.
 struct GlobalId
 {
-    GlobalId(const std::string path, const Dxyz& key)
-        : path(path)
+    GlobalId(const uint64_t dataset, const Dxyz& key)
+        : dataset(dataset)
         , key(key)
     { }
 
-    const std::string path;
+    const uint64_t dataset;
     const Dxyz key;
 };
 
@@ -40,36 +50,100 @@ bool operator<(const GlobalId& a, const GlobalId& b);
 struct ChunkReaderInfo
 {
     using Map = std::map<GlobalId, ChunkReaderInfo>;
-    using Order = std::list<Map::iterator>;
+    using Order = std::multimap<double, Map::iterator>;
+
+    // Shared by all callers which request this chunk while it is loading.
+    std::shared_future<SharedChunkReader> chunk;
 
-    SharedChunkReader chunk;
+    // Until loaded, this entry is not in the eviction order and so cannot be
+    // purged.
+    bool loaded = false;
+    std::size_t bytes = 0;
+    double cost = 0;
+    uint64_t hits = 0;
     Order::iterator it;
 };
 
+// A chunk cache which may be shared by any number of readers, and which is
+// split into shards, each with its own lock and an even portion of the total
+// size budget.
+//
+// Rather than evicting the least recently used chunk, each shard evicts the
+// chunk with the lowest priority, where a chunk's priority is the cost of
+// loading it per byte, scaled by its hit count, plus an aging term which
+// rises as chunks are evicted (GreedyDual-Size-Frequency).  The cost of a
+// chunk is the time it took to fetch and decode, weighted toward shallow
+// chunks since nearly every query overlaps them.
 class Cache
 {
 public:
-    Cache(std::size_t maxBytes = 1024 * 1024 * 256) // 250 MB.
-        : m_maxBytes(maxBytes)
-    { }
+    Cache(
+            std::size_t maxBytes = 1024 * 1024 * 256,   // 256 MB.
+            std::size_t shards = 8);
+
+    // Used by readers which are not given a cache of their own, so its budget
+    // applies across all of them.
+    static std::shared_ptr<Cache> global();
 
     std::size_t maxBytes() const { return m_maxBytes; }
+    void setMaxBytes(std::size_t maxBytes);
 
+    // Register a dataset, returning the ID by which its chunks are cached.
+    uint64_t attach();
+
+    // Drop the cached chunks of a dataset which will no longer be read.
+    void detach(uint64_t dataset);
+
+    // Acquire the chunks for _keys_, with at least the dimensions named in
+    // _dims_ read, or all dimensions if _dims_ is empty.
     std::deque<SharedChunkReader> acquire(
             const Reader& reader,
-            const std::vector<Dxyz>& keys);
+            const std::vector<Dxyz>& keys,
+            const std::set<std::string>& dims = std::set<std::string>());
+
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t waits = 0;         // Hits on chunks which were loading.
+        uint64_t evictions = 0;
+        uint64_t evictedBytes = 0;
+    };
+
+    Stats stats() const;
+    std::size_t size() const;
+    Json::Value toJson() const;
 
 private:
-    SharedChunkReader get(const Reader& reader, const Dxyz& id);
-    void purge();
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        ChunkReaderInfo::Map chunks;
+        ChunkReaderInfo::Order order;
+        std::size_t size = 0;
+        double age = 0;
+        Stats stats;
+    };
+
+    Shard& shard(const GlobalId& id);
+
+    // Called without any lock held.  Concurrent requests for a chunk which is
+    // not yet cached result in a single load, which the other requesters
+    // wait for, while different chunks load in parallel.
+    SharedChunkReader get(
+            const Reader& reader,
+            const Dxyz& id,
+            const std::set<std::string>& dims);
 
-    const std::size_t m_maxBytes;
+    // Update the eviction priority of a loaded chunk, with its shard locked.
+    void touch(Shard& s, ChunkReaderInfo::Map::iterator it);
+    void purge(Shard& s);
 
-    mutable std::mutex m_mutex;
-    std::size_t m_size = 0;
+    std::size_t shardBytes() const { return m_maxBytes / m_shards.size(); }
 
-    ChunkReaderInfo::Map m_chunks;
-    ChunkReaderInfo::Order m_order;
+    std::atomic_size_t m_maxBytes;
+    std::atomic<uint64_t> m_datasets { 0 };
+    std::vector<std::unique_ptr<Shard>> m_shards;
 };
 
 } // namespace entwine
@@ -10,33 +10,127 @@
 
 #include <entwine/reader/chunk-reader.hpp>
 
+#include <algorithm>
+
 #include <entwine/io/io.hpp>
 #include <entwine/reader/reader.hpp>
+#include <entwine/util/buffer-pool.hpp>
 
 namespace entwine
 {
 
-ChunkReader::ChunkReader(const Reader& r, const Dxyz& id)
+ChunkReader::ChunkReader(
+        const Reader& r,
+        const Dxyz& id,
+        const std::set<std::string>& dims)
+    : m_name(id.toString())
 {
+    const Schema& schema(r.metadata().schema());
+    const DataIo& io(r.metadata().dataIo());
+    const auto dataEp(r.ep().getSubEndpoint("ept-data"));
+
+    // The hierarchy knows how many points this chunk holds, so our buffer,
+    // drawn from the pool, is sized for exactly that many.
+    BufferPool& pool(BufferPool::instance());
+    const std::size_t pointSize(schema.pointSize());
+    const uint64_t np(std::max<uint64_t>(r.hierarchy().count(id), 1));
+
     std::vector<char> data;
 
-    VectorPointTable tmp(r.metadata().schema());
-    tmp.setProcess([&data, &tmp]()
+    if (io.columnar() && !dims.empty())
     {
-        data.insert(
-                data.end(),
-                tmp.data().data(),
-                tmp.data().data() + tmp.numPoints() * tmp.pointSize());
-    });
+        for (const DimInfo& d : schema.dims())
+        {
+            if (dims.count(d.name())) m_dims.insert(d.name());
+        }
 
-    const auto dataEp(r.ep().getSubEndpoint("ept-data"));
-    r.metadata().dataIo().read(dataEp, r.tmp(), id.toString(), tmp);
+        // Emptied, but with its storage retained for readDims to fill.
+        data = pool.acquire(np * pointSize);
+        data.clear();
+
+        io.readDims(dataEp, r.tmp(), m_name, m_dims, data);
+    }
+    else
+    {
+        for (const DimInfo& d : schema.dims()) m_dims.insert(d.name());
+
+        // Decode in place, so only if the count turns out to be wrong do any
+        // points need to be copied.  Every batch is written to the start of
+        // the table, and all but the last batch fill it, so with room for one
+        // more point than expected, a correct count is always read in a
+        // single partial batch.  A full batch means that the count was too
+        // small, and since the next batch would overwrite it, it is copied
+        // out along with every batch that follows.
+        VectorPointTable table(schema, pool.acquire((np + 1) * pointSize));
+
+        uint64_t filled(0);
+        std::vector<char> extra;
+
+        table.setProcess([&table, &filled, &extra, pointSize]()
+        {
+            const char* pos(table.getPoint(0));
+            const uint64_t n(table.numPoints());
+
+            if (extra.empty() && n < table.capacity()) filled = n;
+            else extra.insert(extra.end(), pos, pos + n * pointSize);
+        });
+
+        io.read(dataEp, r.tmp(), m_name, table);
+        table.setProcess([]() { });
+
+        data = table.acquire();
+
+        if (extra.empty()) data.resize(filled * pointSize);
+        else
+        {
+            pool.release(std::move(data));
+            data = std::move(extra);
+        }
+    }
 
-    m_table = makeUnique<VectorPointTable>(
-            r.metadata().schema(),
-            std::move(data));
+    m_table = makeUnique<VectorPointTable>(schema, std::move(data));
     m_table->clear(m_table->capacity());
 }
 
-} // namespace entwine
+ChunkReader::~ChunkReader()
+{
+    BufferPool::instance().release(m_table->acquire());
+}
+
+void ChunkReader::ensure(const Reader& r, const std::set<std::string>& dims)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::set<std::string> missing;
+
+    if (dims.empty())
+    {
+        for (const DimInfo& d : r.metadata().schema().dims())
+        {
+            if (!m_dims.count(d.name())) missing.insert(d.name());
+        }
+    }
+    else
+    {
+        for (const std::string& name : dims)
+        {
+            if (!m_dims.count(name) && r.metadata().schema().contains(name))
+            {
+                missing.insert(name);
+            }
+        }
+    }
+
+    if (missing.empty()) return;
+
+    const auto dataEp(r.ep().getSubEndpoint("ept-data"));
+    r.metadata().dataIo().readDims(
+            dataEp,
+            r.tmp(),
+            m_name,
+            missing,
+            m_table->data());
 
+    m_dims.insert(missing.begin(), missing.end());
+}
+
+} // namespace entwine
@@ -11,6 +11,9 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
+#include <set>
+#include <string>
 
 #include <entwine/types/key.hpp>
 #include <entwine/types/vector-point-table.hpp>
@@ -24,15 +27,32 @@ class Reader;
 class ChunkReader
 {
 public:
-    ChunkReader(const Reader& reader, const Dxyz& id);
+    // Read the dimensions named in _dims_, or all dimensions if _dims_ is
+    // empty.  Data types which do not store dimensions separately always read
+    // every dimension.
+    ChunkReader(
+            const Reader& reader,
+            const Dxyz& id,
+            const std::set<std::string>& dims = std::set<std::string>());
+
+    // Returns our point data to the buffer pool.
+    ~ChunkReader();
+
+    // Read any dimensions of _dims_ which have not yet been read.
+    void ensure(const Reader& reader, const std::set<std::string>& dims);
 
     VectorPointTable& table() { return *m_table; }
     std::size_t bytes() const
     {
-        return m_table->capacity() + m_table->pointSize();
+        return sizeof(ChunkReader) + sizeof(VectorPointTable) +
+            m_table->data().capacity();
     }
 
 private:
+    const std::string m_name;
+
+    std::mutex m_mutex;
+    std::set<std::string> m_dims;
     std::unique_ptr<VectorPointTable> m_table;
 };
 
@@ -152,7 +152,13 @@ std::unique_ptr<Comparison> Comparison::create(
         throw std::runtime_error("Unknown dimension: " + dimensionName);
     }
 
-    return makeUnique<Comparison>(id, dimensionName, std::move(op));
+    const pdal::PointLayout& layout(metadata.schema().pdalLayout());
+    return makeUnique<Comparison>(
+            id,
+            dimensionName,
+            layout.dimOffset(id),
+            layout.dimType(id),
+            std::move(op));
 }
 
 std::unique_ptr<ComparisonOperator> ComparisonOperator::create(
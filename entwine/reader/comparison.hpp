@@ -10,10 +10,16 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
+#include <pdal/util/Utils.hpp>
+
 #include <entwine/reader/filterable.hpp>
 #include <entwine/types/bounds.hpp>
+#include <entwine/types/dim-info.hpp>
 #include <entwine/types/defs.hpp>
 #include <entwine/util/unique.hpp>
 
@@ -110,6 +116,18 @@ public:
 
     virtual bool operator()(double in) const = 0;
     virtual bool operator()(const Bounds& bounds) const { return true; }
+
+    // True only if every value within [lo, hi] is known to pass.
+    virtual bool all(double lo, double hi) const { return false; }
+
+    // False only if no value within [lo, hi] can pass.
+    virtual bool any(double lo, double hi) const { return true; }
+
+    // Compare _n_ values at once, writing the results to _out_.
+    virtual void apply(const double* in, std::size_t n, uint8_t* out) const
+    {
+        for (std::size_t i(0); i < n; ++i) out[i] = (*this)(in[i]);
+    }
     virtual void log(const std::string& pre) const = 0;
 
     virtual std::vector<Origin> origins() const
@@ -139,11 +157,46 @@ public:
         return m_op(in, m_val);
     }
 
+    // Our operator is known here, so this loop may be vectorized.
+    virtual void apply(const double* in, std::size_t n, uint8_t* out) const
+        override
+    {
+        const double val(m_val);
+        for (std::size_t i(0); i < n; ++i) out[i] = m_op(in[i], val);
+    }
+
     virtual bool operator()(const Bounds& bounds) const override
     {
         return !m_bounds || m_bounds->overlaps(bounds.growBy(.005));
     }
 
+    virtual bool all(double lo, double hi) const override
+    {
+        switch (m_type)
+        {
+            case ComparisonType::gt:    return lo > m_val;
+            case ComparisonType::gte:   return lo >= m_val;
+            case ComparisonType::lt:    return hi < m_val;
+            case ComparisonType::lte:   return hi <= m_val;
+            case ComparisonType::ne:    return m_val < lo || m_val > hi;
+            default:                    return lo == hi && m_op(lo, m_val);
+        }
+    }
+
+    virtual bool any(double lo, double hi) const override
+    {
+        switch (m_type)
+        {
+            case ComparisonType::eq:    return lo <= m_val && m_val <= hi;
+            case ComparisonType::gt:    return hi > m_val;
+            case ComparisonType::gte:   return hi >= m_val;
+            case ComparisonType::lt:    return lo < m_val;
+            case ComparisonType::lte:   return lo <= m_val;
+            case ComparisonType::ne:    return lo != hi || lo != m_val;
+            default:                    return true;
+        }
+    }
+
     virtual void log(const std::string& pre) const override
     {
         std::cout << pre << toString(m_type) << " " << m_val;
@@ -210,6 +263,29 @@ public:
         });
     }
 
+    virtual void apply(const double* in, std::size_t n, uint8_t* out) const
+        override
+    {
+        std::fill(out, out + n, 0);
+        for (const double val : m_vals)
+        {
+            for (std::size_t i(0); i < n; ++i) out[i] |= in[i] == val;
+        }
+    }
+
+    virtual bool all(double lo, double hi) const override
+    {
+        return lo == hi && (*this)(lo);
+    }
+
+    virtual bool any(double lo, double hi) const override
+    {
+        return std::any_of(m_vals.begin(), m_vals.end(), [lo, hi](double v)
+        {
+            return v >= lo && v <= hi;
+        });
+    }
+
     virtual bool operator()(const Bounds& bounds) const override
     {
         if (m_boundsList.empty()) return true;
@@ -241,6 +317,29 @@ public:
             return in == val;
         });
     }
+
+    virtual void apply(const double* in, std::size_t n, uint8_t* out) const
+        override
+    {
+        std::fill(out, out + n, 1);
+        for (const double val : m_vals)
+        {
+            for (std::size_t i(0); i < n; ++i) out[i] &= in[i] != val;
+        }
+    }
+
+    virtual bool all(double lo, double hi) const override
+    {
+        return std::none_of(m_vals.begin(), m_vals.end(), [lo, hi](double v)
+        {
+            return v >= lo && v <= hi;
+        });
+    }
+
+    virtual bool any(double lo, double hi) const override
+    {
+        return lo != hi || (*this)(lo);
+    }
 };
 
 template<typename O>
@@ -256,12 +355,18 @@ inline std::unique_ptr<ComparisonSingle<O>> createSingle(
 class Comparison : public Filterable
 {
 public:
+    // The dimension is at byte position _pos_, with type _type_, within the
+    // points of the absolute schema.
     Comparison(
             pdal::Dimension::Id dim,
             const std::string& dimensionName,
+            std::size_t pos,
+            DimType type,
             std::unique_ptr<ComparisonOperator> op)
         : m_dim(dim)
         , m_name(dimensionName)
+        , m_pos(pos)
+        , m_type(type)
         , m_op(std::move(op))
     { }
 
@@ -280,6 +385,56 @@ public:
         return (*m_op)(bounds);
     }
 
+    // Only spatial dimensions are known from _bounds_.
+    bool contains(const Bounds& bounds) const override
+    {
+        if (!DimInfo::isXyz(m_dim)) return false;
+
+        const std::size_t pos(pdal::Utils::toNative(m_dim) - 1);
+        return m_op->all(bounds.min()[pos], bounds.max()[pos]);
+    }
+
+    // Where the values of our dimension which occur within a node were
+    // recorded, each run of them is checked, otherwise only their range is.
+    bool check(const NodeStats& stats) const override
+    {
+        const NodeStats::Dim* d(stats.find(m_name));
+        if (!d) return true;
+        if (d->runs.empty()) return m_op->any(d->min, d->max);
+
+        return std::any_of(
+                d->runs.begin(),
+                d->runs.end(),
+                [this](const NodeStats::Run& r)
+                {
+                    return m_op->any(r.first, r.second);
+                });
+    }
+
+    bool contains(const NodeStats& stats) const override
+    {
+        const NodeStats::Dim* d(stats.find(m_name));
+        if (!d) return false;
+        if (d->runs.empty()) return m_op->all(d->min, d->max);
+
+        return std::all_of(
+                d->runs.begin(),
+                d->runs.end(),
+                [this](const NodeStats::Run& r)
+                {
+                    return m_op->all(r.first, r.second);
+                });
+    }
+
+    void check(const PointBlock& block, Mask& mask) const override
+    {
+        thread_local std::vector<double> values;
+        readColumn(block, m_pos, m_type, values);
+
+        mask.resize(block.size);
+        m_op->apply(values.data(), block.size, mask.data());
+    }
+
     virtual void log(const std::string& pre) const override
     {
         std::cout << pre << m_name << " ";
@@ -289,6 +444,8 @@ public:
 protected:
     pdal::Dimension::Id m_dim;
     std::string m_name;
+    std::size_t m_pos;
+    DimType m_type;
     std::unique_ptr<ComparisonOperator> m_op;
 };
 
@@ -0,0 +1,146 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/reader/encoder.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <entwine/io/io.hpp>
+#include <entwine/io/laszip.hpp>
+#include <entwine/io/zstandard.hpp>
+#include <entwine/types/vector-point-table.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    const int zstandardLevel(3);
+
+    std::string typeOf(const Json::Value& json, const Schema& schema)
+    {
+        const std::string type(json.isNull() ? "binary" : json.asString());
+
+        if (type == "binary" || type == "columnar") return type;
+
+        if (type == "zstandard")
+        {
+#ifndef ENTWINE_HAVE_ZSTD
+            throw std::runtime_error("Entwine was not built with Zstandard");
+#endif
+            return type;
+        }
+
+        if (type == "laszip")
+        {
+#ifndef ENTWINE_HAVE_LASZIP
+            throw std::runtime_error("Entwine was not built with LASzip");
+#endif
+            if (!schema.isScaled())
+            {
+                throw std::runtime_error("Laszip output requires scaling.");
+            }
+            return type;
+        }
+
+        throw std::runtime_error("Invalid encoding: " + type);
+    }
+
+    bool passes(const Metadata& m, const Schema& schema, const std::string& t)
+    {
+        const DataIo& io(m.dataIo());
+        if (io.type() != t || schema != m.outSchema()) return false;
+
+        if (t == "binary" || t == "laszip") return true;
+
+        // Frames compressed with a dictionary can't be decoded without it.
+        if (t == "zstandard")
+        {
+            const Json::Value options(io.options());
+            return
+                !options["dictionary"].asBool() &&
+                !options.isMember("dictionaryId");
+        }
+
+        // Stored columnar nodes are compressed column by column, so they
+        // differ from our columnar encoding.
+        return false;
+    }
+}
+
+Encoder::Encoder(
+        const Metadata& metadata,
+        const Schema& schema,
+        const Json::Value& json)
+    : m_metadata(metadata)
+    , m_schema(schema)
+    , m_plan(metadata.schema(), schema)
+    , m_type(typeOf(json, schema))
+    , m_passthrough(passes(metadata, schema, m_type))
+{ }
+
+std::vector<char> Encoder::encode(const std::vector<const char*>& points) const
+{
+#ifdef ENTWINE_HAVE_LASZIP
+    if (m_type == "laszip")
+    {
+        // The points are only read, through a table which requires them to
+        // be mutable.
+        std::vector<char*> refs;
+        refs.reserve(points.size());
+        for (const char* p : points) refs.push_back(const_cast<char*>(p));
+
+        BlockPointTable table(m_metadata.schema(), std::move(refs));
+        return Laz::encode(
+                m_metadata.schema(),
+                m_schema,
+                m_metadata.srs(),
+                table);
+    }
+#endif
+
+    const std::size_t pointSize(m_plan.dstPointSize());
+    std::vector<char> packed(points.size() * pointSize);
+    m_plan.apply(points.data(), packed.data(), points.size());
+
+    if (m_type == "binary") return packed;
+
+#ifdef ENTWINE_HAVE_ZSTD
+    if (m_type == "zstandard")
+    {
+        return Zstandard::compress(
+                packed.data(),
+                packed.size(),
+                zstandardLevel);
+    }
+#endif
+
+    std::vector<char> columns(packed.size());
+    char* pos(columns.data());
+
+    const pdal::PointLayout& layout(m_schema.pdalLayout());
+    for (const DimInfo& d : m_schema.dims())
+    {
+        const std::size_t offset(layout.dimOffset(d.id()));
+        const std::size_t size(d.size());
+
+        for (std::size_t i(0); i < points.size(); ++i)
+        {
+            const char* src(packed.data() + i * pointSize + offset);
+            pos = std::copy(src, src + size, pos);
+        }
+    }
+
+    return columns;
+}
+
+} // namespace entwine
+
@@ -0,0 +1,63 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+
+#include <entwine/types/copy-plan.hpp>
+#include <entwine/types/metadata.hpp>
+#include <entwine/types/schema.hpp>
+
+namespace entwine
+{
+
+// Encodes selected points, laid out according to the absolute schema of a
+// dataset, for output in the layout of _schema_.  The encoding is one of:
+//
+//      "binary":       The points packed according to _schema_.
+//      "zstandard":    A Zstandard frame of their binary encoding.  Since
+//                      frames may be concatenated, so may these encodings.
+//      "columnar":     The values of each dimension of _schema_ in turn, each
+//                      packed contiguously.
+//      "laszip":       A LAZ file, which requires that XYZ be scaled.
+//
+// The conversion to _schema_ is performed as part of encoding, so selected
+// points are never copied to an intermediate layout.
+class Encoder
+{
+public:
+    Encoder(
+            const Metadata& metadata,
+            const Schema& schema,
+            const Json::Value& json);
+
+    const std::string& type() const { return m_type; }
+    bool binary() const { return m_type == "binary"; }
+
+    std::vector<char> encode(const std::vector<const char*>& points) const;
+
+    // True if the stored nodes of our dataset are identical to our encoding
+    // of all of their points, so they may be output without being decoded.
+    bool passthrough() const { return m_passthrough; }
+
+private:
+    const Metadata& m_metadata;
+    const Schema& m_schema;
+    const CopyPlan m_plan;
+    const std::string m_type;
+    const bool m_passthrough;
+};
+
+} // namespace entwine
+
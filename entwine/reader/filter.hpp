@@ -10,7 +10,9 @@
 
 #pragma once
 
+#include <set>
 #include <string>
+#include <vector>
 
 #include <json/json.h>
 
@@ -36,6 +38,9 @@ public:
         : m_metadata(metadata)
         , m_queryBounds(queryBounds)
         , m_root()
+        , m_x(column(DimId::X))
+        , m_y(column(DimId::Y))
+        , m_z(column(DimId::Z))
     {
         if (json.isObject()) build(m_root, json);
         else if (!json.isNull())
@@ -54,12 +59,100 @@ public:
         return m_queryBounds.overlaps(bounds) && m_root.check(bounds);
     }
 
+    // True if every point within _bounds_ is within the query bounds.
+    bool within(const Bounds& bounds) const
+    {
+        const Point& qmin(m_queryBounds.min());
+        const Point& qmax(m_queryBounds.max());
+        const Point& bmin(bounds.min());
+        const Point& bmax(bounds.max());
+
+        // Points may lie on the upper faces of _bounds_, but the query
+        // bounds exclude their own upper faces.
+        return
+            qmin.x <= bmin.x && bmax.x < qmax.x &&
+            qmin.y <= bmin.y && bmax.y < qmax.y &&
+            (!m_queryBounds.is3d() || (qmin.z <= bmin.z && bmax.z < qmax.z));
+    }
+
+    // True if every point within _bounds_ passes this filter, regardless of
+    // the query bounds.
+    bool contains(const Bounds& bounds) const
+    {
+        return m_root.contains(bounds);
+    }
+
+    // As above, for the points of a node with the recorded _stats_.
+    bool check(const NodeStats& stats) const { return m_root.check(stats); }
+    bool contains(const NodeStats& stats) const
+    {
+        return m_root.contains(stats);
+    }
+
+    // Select the points of _block_ which are within the query bounds and
+    // which pass this filter.  Either check may be skipped if it is known to
+    // pass for the whole block.
+    void select(
+            const PointBlock& block,
+            Mask& mask,
+            bool clip = true,
+            bool filter = true) const
+    {
+        if (filter) m_root.check(block, mask);
+        else mask.assign(block.size, 1);
+
+        if (!clip) return;
+
+        thread_local std::vector<double> x, y, z;
+        readColumn(block, m_x.pos, m_x.type, x);
+        readColumn(block, m_y.pos, m_y.type, y);
+
+        const Point& min(m_queryBounds.min());
+        const Point& max(m_queryBounds.max());
+
+        if (m_queryBounds.is3d())
+        {
+            readColumn(block, m_z.pos, m_z.type, z);
+            for (std::size_t i(0); i < block.size; ++i)
+            {
+                mask[i] &=
+                    x[i] >= min.x && x[i] < max.x &&
+                    y[i] >= min.y && y[i] < max.y &&
+                    z[i] >= min.z && z[i] < max.z;
+            }
+        }
+        else
+        {
+            for (std::size_t i(0); i < block.size; ++i)
+            {
+                mask[i] &=
+                    x[i] >= min.x && x[i] < max.x &&
+                    y[i] >= min.y && y[i] < max.y;
+            }
+        }
+    }
+
     void log() const
     {
         m_root.log("");
     }
 
+    // The names of the dimensions on which this filter depends.
+    const std::set<std::string>& dims() const { return m_dims; }
+
 private:
+    struct Column
+    {
+        std::size_t pos;
+        DimType type;
+    };
+
+    Column column(DimId id) const
+    {
+        const pdal::PointLayout& layout(m_metadata.schema().pdalLayout());
+        return Column { layout.dimOffset(id), layout.dimType(id) };
+    }
+
     void build(LogicGate& gate, const Json::Value& json)
     {
         if (json.isObject())
@@ -88,6 +181,7 @@ private:
                 {
                     // a comparison query object.
                     active->push(Comparison::create(m_metadata, key, val));
+                    addDim(key);
                 }
                 else
                 {
@@ -106,6 +200,7 @@ private:
                         next[innerKey] = val[innerKey];
                         active->push(Comparison::create(m_metadata, key, next));
                     }
+                    addDim(key);
                 }
             }
 
@@ -122,9 +217,19 @@ private:
         }
     }
 
+    void addDim(const std::string& name)
+    {
+        m_dims.insert(name == "Path" ? "OriginId" : name);
+    }
+
     const Metadata& m_metadata;
     const Bounds m_queryBounds;
     LogicalAnd m_root;
+    std::set<std::string> m_dims;
+
+    const Column m_x;
+    const Column m_y;
+    const Column m_z;
 };
 
 } // namespace entwine
@@ -0,0 +1,100 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/reader/filterable.hpp>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace entwine
+{
+
+namespace
+{
+    // Reads the value at _pos_ of each of _n_ points, where _point_ returns
+    // the address of the point at an index.
+    template<typename T, typename F>
+    void readAs(
+            const std::size_t n,
+            F point,
+            const std::size_t pos,
+            std::vector<double>& values)
+    {
+        T v;
+        for (std::size_t i(0); i < n; ++i)
+        {
+            std::memcpy(&v, point(i) + pos, sizeof(T));
+            values[i] = static_cast<double>(v);
+        }
+    }
+
+    template<typename F>
+    void read(
+            const std::size_t n,
+            F point,
+            const std::size_t pos,
+            const DimType type,
+            std::vector<double>& values)
+    {
+        values.resize(n);
+
+        switch (type)
+        {
+            case DimType::Signed8:
+                readAs<int8_t>(n, point, pos, values); break;
+            case DimType::Signed16:
+                readAs<int16_t>(n, point, pos, values); break;
+            case DimType::Signed32:
+                readAs<int32_t>(n, point, pos, values); break;
+            case DimType::Signed64:
+                readAs<int64_t>(n, point, pos, values); break;
+            case DimType::Unsigned8:
+                readAs<uint8_t>(n, point, pos, values); break;
+            case DimType::Unsigned16:
+                readAs<uint16_t>(n, point, pos, values); break;
+            case DimType::Unsigned32:
+                readAs<uint32_t>(n, point, pos, values); break;
+            case DimType::Unsigned64:
+                readAs<uint64_t>(n, point, pos, values); break;
+            case DimType::Float:
+                readAs<float>(n, point, pos, values); break;
+            case DimType::Double:
+                readAs<double>(n, point, pos, values); break;
+            default: throw std::runtime_error("Invalid dimension type");
+        }
+    }
+}
+
+void readColumn(
+        const PointBlock& block,
+        const std::size_t pos,
+        const DimType type,
+        std::vector<double>& values)
+{
+    const char* data(block.data);
+    const std::size_t pointSize(block.pointSize);
+    auto point([data, pointSize](std::size_t i)
+    {
+        return data + i * pointSize;
+    });
+    read(block.size, point, pos, type, values);
+}
+
+void readColumn(
+        const std::vector<const char*>& points,
+        const std::size_t pos,
+        const DimType type,
+        std::vector<double>& values)
+{
+    auto point([&points](std::size_t i) { return points[i]; });
+    read(points.size(), point, pos, type, values);
+}
+
+} // namespace entwine
@@ -11,20 +11,64 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include <pdal/PointRef.hpp>
 
 #include <entwine/types/bounds.hpp>
+#include <entwine/types/defs.hpp>
+#include <entwine/types/node-stats.hpp>
 
 namespace entwine
 {
 
+// A run of contiguous points, laid out according to the absolute schema.
+struct PointBlock
+{
+    const char* data;
+    std::size_t pointSize;
+    std::size_t size;
+};
+
+// One value per point of a block, nonzero for points which pass a filter.
+using Mask = std::vector<uint8_t>;
+
+// Read the dimension of type _type_ at byte position _pos_ within each point
+// of _block_ into _values_.
+void readColumn(
+        const PointBlock& block,
+        std::size_t pos,
+        DimType type,
+        std::vector<double>& values);
+
+// As above, for any list of points.
+void readColumn(
+        const std::vector<const char*>& points,
+        std::size_t pos,
+        DimType type,
+        std::vector<double>& values);
+
 class Filterable
 {
 public:
     virtual bool check(const pdal::PointRef& pointRef) const = 0;
+
+    // False only if no point within _bounds_ can pass.
     virtual bool check(const Bounds& bounds) const { return true; }
+
+    // True only if every point within _bounds_ is known to pass.
+    virtual bool contains(const Bounds& bounds) const { return false; }
+
+    // As above, for the points of a node with the recorded _stats_.
+    virtual bool check(const NodeStats& stats) const { return true; }
+    virtual bool contains(const NodeStats& stats) const { return false; }
+
+    // Evaluate every point of _block_ at once, setting _mask_ to the result
+    // for each.
+    virtual void check(const PointBlock& block, Mask& mask) const = 0;
+
     virtual void log(const std::string& pre) const = 0;
 };
 
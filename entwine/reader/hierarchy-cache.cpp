@@ -0,0 +1,113 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/reader/hierarchy-cache.hpp>
+
+namespace entwine
+{
+
+HierarchyCache::HierarchyCache(const std::size_t maxBytes)
+    : m_maxBytes(maxBytes)
+{ }
+
+std::size_t HierarchyCache::maxBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_maxBytes;
+}
+
+void HierarchyCache::setMaxBytes(const std::size_t maxBytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxBytes = maxBytes;
+    purge();
+}
+
+uint64_t HierarchyCache::attach()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_datasets++;
+}
+
+void HierarchyCache::detach(const uint64_t dataset)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it(m_pages.lower_bound(GlobalId(dataset, Dxyz())));
+    while (it != m_pages.end() && it->first.dataset == dataset)
+    {
+        m_size -= it->second.page->bytes;
+        m_order.erase(it->second.it);
+        it = m_pages.erase(it);
+    }
+}
+
+HierarchyCache::SharedPage HierarchyCache::find(const GlobalId& id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto it(m_pages.find(id));
+    if (it == m_pages.end()) return SharedPage();
+
+    Entry& entry(it->second);
+    m_order.splice(m_order.begin(), m_order, entry.it);
+    return entry.page;
+}
+
+void HierarchyCache::insert(const GlobalId& id, const SharedPage page)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Another caller may have fetched this page concurrently.
+    if (m_pages.count(id)) return;
+
+    m_order.push_front(id);
+
+    Entry& entry(m_pages[id]);
+    entry.page = page;
+    entry.it = m_order.begin();
+    m_size += page->bytes;
+
+    purge();
+}
+
+void HierarchyCache::purge()
+{
+    while (m_size > m_maxBytes && m_order.size() > 1)
+    {
+        const auto victim(m_pages.find(m_order.back()));
+        m_size -= victim->second.page->bytes;
+        m_pages.erase(victim);
+        m_order.pop_back();
+    }
+}
+
+std::size_t HierarchyCache::pages(const uint64_t dataset) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::size_t n(0);
+    auto it(m_pages.lower_bound(GlobalId(dataset, Dxyz())));
+    while (it != m_pages.end() && it->first.dataset == dataset)
+    {
+        ++n;
+        ++it;
+    }
+    return n;
+}
+
+std::size_t HierarchyCache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_size;
+}
+
+} // namespace entwine
+
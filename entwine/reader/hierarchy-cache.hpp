@@ -0,0 +1,85 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <entwine/reader/cache.hpp>
+#include <entwine/types/key.hpp>
+#include <entwine/types/node-stats.hpp>
+
+namespace entwine
+{
+
+// Maps nodes to their point counts, where a count of -1 marks the root of a
+// subpage, along with the statistics of those nodes if they were recorded
+// by the builder.
+struct HierarchyPage
+{
+    std::map<Dxyz, int64_t> counts;
+    std::map<Dxyz, std::shared_ptr<const NodeStats>> stats;
+    std::size_t bytes = 0;
+};
+
+// Hierarchy pages of any number of datasets, keyed like the chunk cache, so
+// that a single size budget bounds the hierarchy memory of all readers which
+// share it.  Pages are evicted in least recently used order.
+class HierarchyCache
+{
+public:
+    using SharedPage = std::shared_ptr<const HierarchyPage>;
+
+    HierarchyCache(std::size_t maxBytes = 1024 * 1024 * 64);    // 64 MB.
+
+    std::size_t maxBytes() const;
+    void setMaxBytes(std::size_t maxBytes);
+
+    // Register a dataset, returning the ID by which its pages are cached.
+    uint64_t attach();
+
+    // Drop the cached pages of a dataset which will no longer be read.
+    void detach(uint64_t dataset);
+
+    // Returns null if the page rooted at _id_ is not cached.
+    SharedPage find(const GlobalId& id);
+
+    // The page just inserted is kept regardless of the budget, so that a
+    // count which needs it can make progress.
+    void insert(const GlobalId& id, SharedPage page);
+
+    // The number of pages cached for _dataset_.
+    std::size_t pages(uint64_t dataset) const;
+    std::size_t size() const;
+
+private:
+    struct Entry
+    {
+        SharedPage page;
+        std::list<GlobalId>::iterator it;
+    };
+
+    void purge();
+
+    mutable std::mutex m_mutex;
+    std::size_t m_maxBytes;
+    std::size_t m_size = 0;
+    uint64_t m_datasets = 0;
+    std::map<GlobalId, Entry> m_pages;
+    std::list<GlobalId> m_order;
+};
+
+} // namespace entwine
+
@@ -0,0 +1,260 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/reader/hierarchy-reader.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <set>
+#include <string>
+
+#include <entwine/io/ensure.hpp>
+#include <entwine/util/json.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    // Approximate size of a std::map node beyond its value.
+    const std::size_t nodeOverhead(32);
+
+    // Pages fetched concurrently by prefetch().
+    const std::size_t maxFetches(16);
+
+    Dxyz ancestor(const Dxyz& p, const uint64_t depth)
+    {
+        const uint64_t shift(p.d - depth);
+        return Dxyz(depth, p.p.x >> shift, p.p.y >> shift, p.p.z >> shift);
+    }
+}
+
+HierarchyReader::HierarchyReader(
+        const arbiter::Endpoint& out,
+        const bool stats,
+        const std::size_t maxBytes)
+    : HierarchyReader(out, stats, std::make_shared<HierarchyCache>(maxBytes))
+{ }
+
+HierarchyReader::HierarchyReader(
+        const arbiter::Endpoint& out,
+        const bool stats,
+        std::shared_ptr<HierarchyCache> cache)
+    : m_ep(out.getSubEndpoint("ept-hierarchy"))
+    , m_stats(stats)
+    , m_cache(cache ? cache : std::make_shared<HierarchyCache>())
+    , m_id(m_cache->attach())
+    , m_root(fetch(Dxyz()))
+{ }
+
+HierarchyReader::~HierarchyReader()
+{
+    m_cache->detach(m_id);
+}
+
+uint64_t HierarchyReader::count(const Dxyz& p) const
+{
+    SharedPage page;
+    return resolve(p, page);
+}
+
+std::shared_ptr<const NodeStats> HierarchyReader::stats(const Dxyz& p) const
+{
+    SharedPage page;
+    if (!resolve(p, page)) return std::shared_ptr<const NodeStats>();
+
+    const auto it(page->stats.find(p));
+    if (it == page->stats.end()) return std::shared_ptr<const NodeStats>();
+    return it->second;
+}
+
+uint64_t HierarchyReader::resolve(const Dxyz& p, SharedPage& page) const
+{
+    uint64_t n(0);
+    Dxyz missing;
+    Held held;
+
+    while (!resolve(p, n, page, missing, held))
+    {
+        const SharedPage fetched(fetch(missing));
+        insert(missing, fetched);
+        held[missing] = fetched;
+    }
+
+    return n;
+}
+
+void HierarchyReader::prefetch(const std::vector<Dxyz>& keys) const
+{
+    Held held;
+    std::size_t bytes(0);
+
+    // Nested pages may be required, so keep going until everything resolves.
+    // Pages are held until then, so if they outgrow the budget of our cache,
+    // the rest are left to be fetched as they are counted.
+    while (bytes <= m_cache->maxBytes())
+    {
+        std::set<Dxyz> roots;
+
+        uint64_t n(0);
+        SharedPage page;
+        Dxyz missing;
+        for (const Dxyz& p : keys)
+        {
+            if (!resolve(p, n, page, missing, held)) roots.insert(missing);
+        }
+
+        if (roots.empty()) return;
+
+        // A bounded number of threads each fetch the next remaining page
+        // until none remain.
+        const std::vector<Dxyz> list(roots.begin(), roots.end());
+        std::vector<SharedPage> pages(list.size());
+        std::atomic<std::size_t> next(0);
+
+        auto work([this, &list, &pages, &next]()
+        {
+            for (std::size_t i(next++); i < list.size(); i = next++)
+            {
+                pages[i] = fetch(list[i]);
+            }
+        });
+
+        std::vector<std::future<void>> workers;
+        const std::size_t threads(std::min(maxFetches, list.size()));
+        for (std::size_t i(0); i < threads; ++i)
+        {
+            workers.push_back(std::async(std::launch::async, work));
+        }
+        for (auto& w : workers) w.get();
+
+        for (std::size_t i(0); i < list.size(); ++i)
+        {
+            insert(list[i], pages[i]);
+            held[list[i]] = pages[i];
+            bytes += pages[i]->bytes;
+        }
+    }
+}
+
+bool HierarchyReader::resolve(
+        const Dxyz& p,
+        uint64_t& count,
+        SharedPage& page,
+        Dxyz& missing,
+        const Held& held) const
+{
+    page = m_root;
+
+    while (true)
+    {
+        Dxyz next;
+        const auto it(page->counts.find(p));
+
+        if (it != page->counts.end())
+        {
+            if (it->second >= 0)
+            {
+                count = it->second;
+                return true;
+            }
+
+            // The root of a subpage also appears within it, with its count.
+            next = p;
+        }
+        else
+        {
+            // Otherwise, if _p_ exists then one of its ancestors in this page
+            // is the root of the subpage which contains it.
+            bool found(false);
+            for (uint64_t d(p.d); d && !found; --d)
+            {
+                const Dxyz a(ancestor(p, d - 1));
+                const auto it(page->counts.find(a));
+                if (it != page->counts.end() && it->second < 0)
+                {
+                    next = a;
+                    found = true;
+                }
+            }
+
+            if (!found)
+            {
+                count = 0;
+                return true;
+            }
+        }
+
+        const auto h(held.find(next));
+        page = h != held.end() ? h->second : find(next);
+        if (!page)
+        {
+            missing = next;
+            return false;
+        }
+    }
+}
+
+HierarchyReader::SharedPage HierarchyReader::fetch(const Dxyz& root) const
+{
+    const std::string filename(root.toString() + ".json");
+    const Json::Value json(parse(ensureGetString(m_ep, filename)));
+
+    auto page(std::make_shared<Page>());
+    for (const std::string& key : json.getMemberNames())
+    {
+        page->counts.emplace(Dxyz(key), json[key].asInt64());
+    }
+    page->bytes = page->counts.size() *
+        (sizeof(decltype(page->counts)::value_type) + nodeOverhead);
+
+    // Indexes built before node statistics were recorded have none.
+    if (m_stats)
+    {
+        const std::string data(
+                ensureGetString(m_ep, root.toString() + ".stats.json"));
+        const Json::Value stats(parse(data));
+        for (const std::string& key : stats.getMemberNames())
+        {
+            page->stats.emplace(
+                    Dxyz(key),
+                    std::make_shared<NodeStats>(stats[key]));
+        }
+
+        // Approximated by their serialized size.
+        page->bytes += data.size();
+    }
+
+    ++m_fetches;
+    return page;
+}
+
+HierarchyReader::SharedPage HierarchyReader::find(const Dxyz& root) const
+{
+    return m_cache->find(GlobalId(m_id, root));
+}
+
+void HierarchyReader::insert(const Dxyz& root, SharedPage page) const
+{
+    m_cache->insert(GlobalId(m_id, root), page);
+}
+
+std::size_t HierarchyReader::pages() const
+{
+    return m_cache->pages(m_id) + 1;
+}
+
+uint64_t HierarchyReader::fetches() const
+{
+    return m_fetches;
+}
+
+} // namespace entwine
@@ -10,57 +10,92 @@
 
 #pragma once
 
-#include <cassert>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
 
+#include <entwine/reader/hierarchy-cache.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/types/key.hpp>
-#include <entwine/util/json.hpp>
+#include <entwine/types/node-stats.hpp>
 
 namespace entwine
 {
 
-class Node
-{
-public:
-};
-
+// Reads the hierarchy a page at a time, as nodes are counted.  Only the root
+// page is fetched on construction, and other pages are cached, up to a size
+// budget, as queries descend into them.  The node statistics alongside each
+// page are fetched with it if _stats_ is set, which is given by our metadata.
 class HierarchyReader
 {
 public:
     using Keys = std::map<Dxyz, uint64_t>;
 
-    HierarchyReader(const arbiter::Endpoint& out)
-        : m_ep(out.getSubEndpoint("ept-hierarchy"))
-    {
-        load();
-    }
+    HierarchyReader(
+            const arbiter::Endpoint& out,
+            bool stats,
+            std::size_t maxBytes = 1024 * 1024 * 64);   // 64 MB.
+
+    // Caches pages in _cache_, which may be shared with other readers.
+    HierarchyReader(
+            const arbiter::Endpoint& out,
+            bool stats,
+            std::shared_ptr<HierarchyCache> cache);
+    ~HierarchyReader();
+
+    // Fetches any pages required to count _p_ which are not cached.
+    uint64_t count(const Dxyz& p) const;
+
+    // Like count, but returns the statistics of _p_, or null if there are
+    // none.
+    std::shared_ptr<const NodeStats> stats(const Dxyz& p) const;
 
-    uint64_t count(const Dxyz& p) const
-    {
-        const auto it(m_keys.find(p));
-        if (it != m_keys.end()) return it->second;
-        else return 0;
-    }
+    // Fetch concurrently, on a bounded number of threads, any uncached pages
+    // which are required to count the nodes of _keys_.  This stops early if
+    // the pages fetched exceed the budget of our cache.
+    void prefetch(const std::vector<Dxyz>& keys) const;
+
+    // The number of pages currently cached, and the number ever fetched.
+    std::size_t pages() const;
+    uint64_t fetches() const;
 
 private:
-    // For now, we'll just load everything on init.  This needs to be hooked up
-    // to a caching mechanism.
-    void load(const Dxyz& root = Dxyz())
-    {
-        const auto json(parse(m_ep.get(root.toString() + ".json")));
-
-        for (const auto str : json.getMemberNames())
-        {
-            const Dxyz key(str);
-            const int64_t n(json[str].asInt64());
-            if (n < 0) load(key);
-            else m_keys[key] = static_cast<uint64_t>(n);
-        }
-    }
+    using Page = HierarchyPage;
+    using SharedPage = HierarchyCache::SharedPage;
+
+    // Pages fetched during a single call, which may have since been evicted.
+    using Held = std::map<Dxyz, SharedPage>;
+
+    // Returns true and sets _count_, and _page_ to the page containing _p_
+    // if it exists, if the pages required to count _p_ are cached or held.
+    // Otherwise returns false and sets _missing_ to the root of the first
+    // page which is neither.
+    bool resolve(
+            const Dxyz& p,
+            uint64_t& count,
+            SharedPage& page,
+            Dxyz& missing,
+            const Held& held) const;
+
+    // Fetch pages until _p_ resolves.
+    uint64_t resolve(const Dxyz& p, SharedPage& page) const;
+
+    SharedPage fetch(const Dxyz& root) const;
+    SharedPage find(const Dxyz& root) const;
+    void insert(const Dxyz& root, SharedPage page) const;
 
     const arbiter::Endpoint m_ep;
-    Keys m_keys;
+    const bool m_stats;
+    const std::shared_ptr<HierarchyCache> m_cache;
+    const uint64_t m_id;
+
+    mutable std::atomic<uint64_t> m_fetches { 0 };
+
+    // Always held, since every count begins from it.
+    const SharedPage m_root;
 };
 
 } // namespace entwine
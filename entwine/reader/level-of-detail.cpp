@@ -0,0 +1,152 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/reader/level-of-detail.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <entwine/types/metadata.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    double positive(const Json::Value& json, const std::string& name)
+    {
+        const double v(json[name].asDouble());
+        if (!(v > 0))
+        {
+            throw std::runtime_error(
+                    "Invalid " + name + ": " + json[name].toStyledString());
+        }
+        return v;
+    }
+}
+
+LevelOfDetail::LevelOfDetail(const Metadata& m, const Json::Value& json)
+    : m_ticks(m.ticks())
+{
+    const int given(
+            json.isMember("resolution") +
+            json.isMember("density") +
+            json.isMember("camera"));
+
+    if (given > 1)
+    {
+        throw std::runtime_error(
+                "Only one of resolution, density, or camera may be given");
+    }
+
+    if (json.isMember("resolution"))
+    {
+        m_resolution = positive(json, "resolution");
+    }
+    else if (json.isMember("density"))
+    {
+        m_resolution = 1.0 / std::sqrt(positive(json, "density"));
+    }
+    else if (json.isMember("camera"))
+    {
+        const Json::Value& c(json["camera"]);
+
+        if (!c["position"].isArray() || c["position"].size() != 3)
+        {
+            throw std::runtime_error("Invalid camera position");
+        }
+
+        m_camera = true;
+        m_position = Point(c["position"]);
+        m_scale =
+            positive(c, "height") / (2.0 * std::tan(positive(c, "fov") / 2.0));
+        if (c.isMember("error")) m_error = positive(c, "error");
+
+        if (c.isMember("matrix"))
+        {
+            const Json::Value& j(c["matrix"]);
+            if (!j.isArray() || j.size() != 16)
+            {
+                throw std::runtime_error("Invalid camera matrix");
+            }
+
+            // Rows of the column-major view-projection matrix, from which the
+            // clipping planes follow (Gribb and Hartmann).
+            std::array<Plane, 4> r;
+            for (Json::ArrayIndex i(0); i < 4; ++i)
+            {
+                for (Json::ArrayIndex k(0); k < 4; ++k)
+                {
+                    r[i][k] = j[k * 4 + i].asDouble();
+                }
+            }
+
+            for (std::size_t i(0); i < 3; ++i)
+            {
+                for (const double sign : { 1.0, -1.0 })
+                {
+                    Plane p;
+                    for (std::size_t k(0); k < 4; ++k)
+                    {
+                        p[k] = r[3][k] + sign * r[i][k];
+                    }
+                    m_planes.push_back(p);
+                }
+            }
+        }
+    }
+}
+
+bool LevelOfDetail::visible(const Bounds& bounds) const
+{
+    const Point& min(bounds.min());
+    const Point& max(bounds.max());
+
+    // Outside if even the corner furthest along the normal of some plane is
+    // behind it.
+    for (const Plane& p : m_planes)
+    {
+        const double x(p[0] >= 0 ? max.x : min.x);
+        const double y(p[1] >= 0 ? max.y : min.y);
+        const double z(p[2] >= 0 ? max.z : min.z);
+        if (p[0] * x + p[1] * y + p[2] * z + p[3] < 0) return false;
+    }
+
+    return true;
+}
+
+bool LevelOfDetail::refine(const Bounds& bounds) const
+{
+    const double spacing(bounds.width() / m_ticks);
+
+    if (m_resolution) return spacing > m_resolution;
+
+    if (m_camera)
+    {
+        // The distance to the nearest point of the node.
+        const Point& min(bounds.min());
+        const Point& max(bounds.max());
+        const Point& p(m_position);
+
+        const double dx(std::max({ min.x - p.x, 0.0, p.x - max.x }));
+        const double dy(std::max({ min.y - p.y, 0.0, p.y - max.y }));
+        const double dz(std::max({ min.z - p.z, 0.0, p.z - max.z }));
+        const double distance(std::sqrt(dx * dx + dy * dy + dz * dz));
+
+        if (!distance) return true;
+        return spacing * m_scale / distance > m_error;
+    }
+
+    return true;
+}
+
+} // namespace entwine
+
@@ -0,0 +1,81 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <json/json.h>
+
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/point.hpp>
+
+namespace entwine
+{
+
+class Metadata;
+
+// Decides, per node, whether a query needs the children of that node, from
+// a target resolution or from a camera.  The point spacing of a node is the
+// width of its bounds divided by the ticks of the index.
+//
+// A target resolution may be given as a point spacing:
+//      { "resolution": 0.5 }
+//
+// or as a density, in points per unit area:
+//      { "density": 4 }
+//
+// in which case nodes are refined until their spacing is at most the target.
+//
+// Alternatively, for a camera:
+//      {
+//          "camera": {
+//              "position": [x, y, z],
+//              "fov": 0.8,                 // Vertical field of view, radians.
+//              "height": 1080,             // Viewport height, pixels.
+//              "error": 2,                 // Screen-space error, pixels.
+//              "matrix": [...]             // Optional view-projection.
+//          }
+//      }
+//
+// where nodes are refined until their spacing, projected at their distance
+// from the camera position, is at most _error_ pixels.  If a column-major
+// view-projection matrix is given, nodes outside of its frustum are skipped
+// entirely.
+class LevelOfDetail
+{
+public:
+    LevelOfDetail(const Metadata& metadata, const Json::Value& json);
+
+    // False if a node with these _bounds_ is known to be out of view.
+    bool visible(const Bounds& bounds) const;
+
+    // True if the children of a node with these _bounds_ are needed.
+    bool refine(const Bounds& bounds) const;
+
+private:
+    // A plane (a, b, c, d) for which ax + by + cz + d >= 0 within the view.
+    using Plane = std::array<double, 4>;
+
+    const uint64_t m_ticks;
+
+    double m_resolution = 0;
+
+    bool m_camera = false;
+    Point m_position;
+    double m_scale = 0;     // Pixels per unit of spacing at unit distance.
+    double m_error = 1;
+    std::vector<Plane> m_planes;
+};
+
+} // namespace entwine
+
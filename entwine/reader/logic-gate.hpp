@@ -79,6 +79,56 @@ public:
         return true;
     }
 
+    virtual bool contains(const Bounds& bounds) const override
+    {
+        for (const auto& f : m_filters)
+        {
+            if (!f->contains(bounds)) return false;
+        }
+
+        return true;
+    }
+
+    virtual bool check(const NodeStats& stats) const override
+    {
+        for (const auto& f : m_filters)
+        {
+            if (!f->check(stats)) return false;
+        }
+
+        return true;
+    }
+
+    virtual bool contains(const NodeStats& stats) const override
+    {
+        for (const auto& f : m_filters)
+        {
+            if (!f->contains(stats)) return false;
+        }
+
+        return true;
+    }
+
+    virtual void check(const PointBlock& block, Mask& mask) const override
+    {
+        mask.assign(block.size, 1);
+
+        Mask inner;
+        for (const auto& f : m_filters)
+        {
+            f->check(block, inner);
+
+            uint8_t any(0);
+            for (std::size_t i(0); i < block.size; ++i)
+            {
+                mask[i] &= inner[i];
+                any |= mask[i];
+            }
+
+            if (!any) return;
+        }
+    }
+
     virtual void log(const std::string& pre) const override
     {
         if (m_filters.size()) std::cout << pre << "AND" << std::endl;
@@ -109,6 +159,56 @@ public:
         return false;
     }
 
+    virtual bool contains(const Bounds& bounds) const override
+    {
+        for (const auto& f : m_filters)
+        {
+            if (f->contains(bounds)) return true;
+        }
+
+        return false;
+    }
+
+    virtual bool check(const NodeStats& stats) const override
+    {
+        for (const auto& f : m_filters)
+        {
+            if (f->check(stats)) return true;
+        }
+
+        return false;
+    }
+
+    virtual bool contains(const NodeStats& stats) const override
+    {
+        for (const auto& f : m_filters)
+        {
+            if (f->contains(stats)) return true;
+        }
+
+        return false;
+    }
+
+    virtual void check(const PointBlock& block, Mask& mask) const override
+    {
+        mask.assign(block.size, 0);
+
+        Mask inner;
+        for (const auto& f : m_filters)
+        {
+            f->check(block, inner);
+
+            uint8_t all(1);
+            for (std::size_t i(0); i < block.size; ++i)
+            {
+                mask[i] |= inner[i];
+                all &= mask[i];
+            }
+
+            if (all) return;
+        }
+    }
+
     virtual void log(const std::string& pre) const override
     {
         std::cout << pre << "OR" << std::endl;
@@ -126,10 +226,33 @@ public:
     }
 
     virtual bool check(const Bounds& bounds) const override
+    {
+        return !LogicalOr::contains(bounds);
+    }
+
+    // If no point within _bounds_ can pass any of our filters, then every
+    // point passes this one.
+    virtual bool contains(const Bounds& bounds) const override
     {
         return !LogicalOr::check(bounds);
     }
 
+    virtual bool check(const NodeStats& stats) const override
+    {
+        return !LogicalOr::contains(stats);
+    }
+
+    virtual bool contains(const NodeStats& stats) const override
+    {
+        return !LogicalOr::check(stats);
+    }
+
+    virtual void check(const PointBlock& block, Mask& mask) const override
+    {
+        LogicalOr::check(block, mask);
+        for (std::size_t i(0); i < block.size; ++i) mask[i] = !mask[i];
+    }
+
     virtual void log(const std::string& pre) const override
     {
         std::cout << pre << "NOR" << std::endl;
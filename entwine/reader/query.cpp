@@ -10,87 +10,519 @@
 
 #include <entwine/reader/query.hpp>
 
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+#include <entwine/io/io.hpp>
 #include <entwine/reader/reader.hpp>
+#include <entwine/util/unique.hpp>
 
 namespace entwine
 {
 
+namespace
+{
+    const std::size_t defaultPrefetch(16);
+    const std::size_t blockSize(4096);
+    const std::size_t maxReserve(64 * 1024 * 1024);
+
+    double deadlineOf(const Json::Value& j)
+    {
+        if (!j.isMember("deadline")) return 0;
+
+        const double ms(j["deadline"].asDouble());
+        if (!(ms > 0))
+        {
+            throw std::runtime_error(
+                    "Invalid deadline: " + j["deadline"].toStyledString());
+        }
+        return ms;
+    }
+}
+
 Query::Query(const Reader& r, const Json::Value& j)
     : m_reader(r)
     , m_metadata(r.metadata())
     , m_hierarchy(r.hierarchy())
     , m_params(j)
     , m_filter(m_metadata, m_params)
-    , m_overlaps(overlaps())
+    , m_lod(m_metadata, j)
+    , m_prefetch(std::max<std::size_t>(
+                j.isMember("prefetch") ?
+                    j["prefetch"].asUInt64() : defaultPrefetch,
+                1))
+    , m_deadline(deadlineOf(j))
+    , m_satisfied(m_params.db())
 { }
 
-HierarchyReader::Keys Query::overlaps() const
+const Query::Overlaps& Query::overlaps() const
 {
-    HierarchyReader::Keys keys;
-    ChunkKey c(m_metadata);
-    overlaps(keys, c);
-    return keys;
+    if (!m_overlaps) m_overlaps = makeUnique<Overlaps>(traverse());
+    return *m_overlaps;
 }
 
-void Query::overlaps(HierarchyReader::Keys& keys, const ChunkKey& c) const
+Query::Overlaps Query::traverse() const
 {
-    if (!m_filter.check(c.bounds())) return;
+    // Traverse a depth at a time, so that the hierarchy pages required by
+    // each depth may be fetched concurrently.
+    Overlaps result;
+    std::vector<ChunkKey> curr;
 
-    const auto k(c.get());
-    const auto count(m_hierarchy.count(k));
-    if (!count) return;
+    const ChunkKey root(m_metadata);
+    if (visible(root)) curr.push_back(root);
 
-    if (c.depth() >= m_params.db()) keys[k] = count;
+    while (!curr.empty())
+    {
+        std::vector<ChunkKey> next;
 
-    if (c.depth() + 1 >= m_params.de()) return;
+        std::vector<Dxyz> ids;
+        for (const ChunkKey& c : curr) ids.push_back(c.get());
+        m_hierarchy.prefetch(ids);
 
-    for (std::size_t i(0); i < dirEnd(); ++i)
-    {
-        overlaps(keys, c.getStep(toDir(i)));
+        for (const ChunkKey& c : curr)
+        {
+            const auto k(c.get());
+            const auto count(m_hierarchy.count(k));
+            if (!count) continue;
+
+            if (c.depth() >= m_params.db())
+            {
+                // The statistics of a node describe only its own points, so
+                // even if none of them pass, its children must be visited.
+                const auto stats(m_hierarchy.stats(k));
+                if (!stats || m_filter.check(*stats))
+                {
+                    Overlap& o(result[k]);
+                    o.count = count;
+                    o.within = m_filter.within(c.bounds());
+                    o.passes =
+                        m_filter.contains(c.bounds()) ||
+                        (stats && m_filter.contains(*stats));
+                }
+            }
+
+            if (c.depth() + 1 >= m_params.de()) continue;
+            if (!m_lod.refine(c.bounds())) continue;
+
+            for (std::size_t i(0); i < dirEnd(); ++i)
+            {
+                const ChunkKey child(c.getStep(toDir(i)));
+                if (visible(child)) next.push_back(child);
+            }
+        }
+
+        curr = std::move(next);
     }
+
+    return result;
+}
+
+bool Query::visible(const ChunkKey& c) const
+{
+    return m_filter.check(c.bounds()) && m_lod.visible(c.bounds());
+}
+
+uint64_t Query::overlapped() const
+{
+    uint64_t n(0);
+    for (const auto& p : overlaps()) n += p.second.count;
+    return n;
+}
+
+std::set<std::string> Query::dims() const
+{
+    std::set<std::string> result(m_filter.dims());
+    result.insert("X");
+    result.insert("Y");
+    result.insert("Z");
+    return result;
+}
+
+uint64_t Query::satisfied() const
+{
+    if (!m_done) return m_satisfied;
+    if (overlaps().empty()) return m_params.db();
+    return overlaps().rbegin()->first.d + 1;
+}
+
+bool Query::stopped() const
+{
+    if (m_cancelled) return true;
+    return m_deadline.count() && Clock::now() - m_start > m_deadline;
 }
 
 void Query::run()
 {
-    for (const auto& k : m_overlaps)
+    m_start = Clock::now();
+    m_satisfied = m_params.db();
+    m_done = false;
+
+    const Overlaps& nodes(overlaps());
+    const std::set<std::string> required(dims());
+
+    // Up to m_prefetch chunks are fetched, decoded, and filtered on the pool
+    // of our reader while we process the selected points of earlier chunks,
+    // which is always done here in node order.
+    using Task = std::packaged_task<Selection()>;
+    std::deque<std::future<Selection>> pending;
+
+    auto it(nodes.begin());
+    auto fill([&]()
     {
-        // For now we're doing one at a time.
-        std::vector<Dxyz> keys;
-        keys.push_back(k.first);
-        auto block(m_reader.cache().acquire(m_reader, keys));
+        while (
+                pending.size() < m_prefetch &&
+                it != nodes.end() &&
+                !stopped())
+        {
+            const Dxyz key(it->first);
+            const Overlap overlap(it->second);
+            ++it;
+
+            auto task(std::make_shared<Task>([this, key, overlap, &required]()
+            {
+                if (stopped())
+                {
+                    Selection selection;
+                    selection.skipped = true;
+                    return selection;
+                }
+
+                Selection selection(select(key, overlap, required));
+                if (!selection.points.empty() &&
+                        (encode(selection.points, selection.encoded) ||
+                         reduce(selection.points)))
+                {
+                    selection.count += selection.points.size();
+                    selection.points.clear();
+                }
+                return selection;
+            }));
+
+            pending.push_back(task->get_future());
+            m_reader.pool().add([task]() { (*task)(); });
+        }
+    });
+
+    // Once any node is skipped, no further depth can be complete, but the
+    // nodes which were already selected are still processed.
+    bool skipped(false);
+    auto complete([&](const uint64_t end)
+    {
+        for ( ; !skipped && m_satisfied < end; ++m_satisfied)
+        {
+            completed(m_satisfied);
+            if (m_onDepth) m_onDepth(m_satisfied);
+        }
+    });
 
-        for (auto& chunk : block)
+    try
+    {
+        fill();
+
+        while (!pending.empty())
         {
-            for (const auto& pr : chunk->table())
+            // Popped before it is consumed, so that if its task threw, only
+            // the tasks still pending remain to be waited on.
+            std::future<Selection> front(std::move(pending.front()));
+            pending.pop_front();
+
+            const Selection selection(front.get());
+            fill();
+
+            if (selection.skipped)
+            {
+                skipped = true;
+                continue;
+            }
+
+            complete(selection.depth);
+
+            m_points += selection.count;
+
+            if (!selection.encoded.empty())
             {
-                maybeProcess(pr);
+                emit(selection.encoded, selection.count);
             }
+
+            if (selection.points.empty()) continue;
+
+            process(selection.points);
+            m_points += selection.points.size();
         }
+
+        // We may have been stopped before any remaining nodes were started.
+        if (it != nodes.end()) skipped = true;
+        if (!skipped && !nodes.empty())
+        {
+            complete(nodes.rbegin()->first.d + 1);
+        }
+
+        m_done = !skipped;
+    }
+    catch (...)
+    {
+        // Outstanding tasks reference this query, so they must complete
+        // before we unwind.
+        for (auto& f : pending) f.wait();
+        throw;
     }
 }
 
-void Query::maybeProcess(const pdal::PointRef& pr)
+Query::Selection Query::select(
+        const Dxyz& key,
+        const Overlap& overlap,
+        const std::set<std::string>& dims) const
 {
-    const Point point(
-            pr.getFieldAs<double>(DimId::X),
-            pr.getFieldAs<double>(DimId::Y),
-            pr.getFieldAs<double>(DimId::Z));
-    if (!m_params.bounds().contains(point) || !m_filter.check(pr)) return;
-    process(pr);
-    ++m_points;
+    Selection selection;
+    selection.depth = key.d;
+
+    // Every point is selected, so if they aren't needed then there's no need
+    // to read them at all.
+    if (overlap.within && overlap.passes &&
+            (!materialize() || summarize(key, overlap.count)))
+    {
+        selection.count = overlap.count;
+        return selection;
+    }
+
+    if (overlap.within && overlap.passes &&
+            passthrough(key, selection.encoded))
+    {
+        selection.count = overlap.count;
+        return selection;
+    }
+
+    auto block(m_reader.cache().acquire(m_reader, { key }, dims));
+    selection.chunk = block.front();
+
+    // Evaluate a block of points at a time, which are contiguous within the
+    // table, and only then gather those which were selected.
+    VectorPointTable& table(selection.chunk->table());
+    const std::size_t np(table.numPoints());
+    const std::size_t pointSize(table.pointSize());
+
+    if (overlap.within && overlap.passes)
+    {
+        selection.points.reserve(np);
+        for (std::size_t i(0); i < np; ++i)
+        {
+            if (!table.skip(i)) selection.points.push_back(table.getPoint(i));
+        }
+        return selection;
+    }
+
+    Mask mask;
+    for (std::size_t begin(0); begin < np; begin += blockSize)
+    {
+        const PointBlock block {
+            table.getPoint(begin),
+            pointSize,
+            std::min(blockSize, np - begin) };
+
+        m_filter.select(block, mask, !overlap.within, !overlap.passes);
+
+        for (std::size_t i(0); i < block.size; ++i)
+        {
+            if (mask[i] && !table.skip(begin + i))
+            {
+                selection.points.push_back(block.data + i * pointSize);
+            }
+        }
+    }
+
+    return selection;
+}
+
+std::set<std::string> ReadQuery::dims() const
+{
+    std::set<std::string> result(Query::dims());
+    for (const DimInfo& d : m_schema.dims()) result.insert(d.name());
+    return result;
+}
+
+std::string ReadQuery::key(
+        const Reader& reader,
+        const Json::Value& json) const
+{
+    if (!reader.results() || !m_encoder.binary()) return std::string();
+    return ResultCache::key(reader.dataset(), json);
+}
+
+bool ReadQuery::fromCache(const Callback& f)
+{
+    ResultCache* results(m_reader.results());
+    if (!results || m_key.empty()) return false;
+
+    const ResultCache::Result result(results->get(m_key));
+    if (!result) return false;
+
+    const std::size_t pointSize(m_plan.dstPointSize());
+    m_points = result->size() / pointSize;
+    m_done = true;
+
+    if (!f)
+    {
+        m_data = *result;
+        return true;
+    }
+
+    const std::size_t batchBytes(m_batchSize * pointSize);
+    for (std::size_t pos(0); pos < result->size(); pos += batchBytes)
+    {
+        const std::size_t n(std::min(batchBytes, result->size() - pos));
+        f(result->data() + pos, n, n / pointSize);
+    }
+
+    return true;
 }
 
-void ReadQuery::process(const pdal::PointRef& pr)
+void ReadQuery::run()
 {
-    m_data.resize(m_data.size() + m_schema.pointSize(), 0);
-    char* pos(m_data.data() + m_data.size() - m_schema.pointSize());
+    if (fromCache(Callback())) return;
 
-    for (const auto& dimInfo : m_schema.dims())
+    m_data.clear();
+    Query::run();
+
+    ResultCache* results(m_reader.results());
+    if (results && !m_key.empty() && done() &&
+            m_data.size() <= results->maxBytes())
     {
-        pr.getField(pos, dimInfo.id(), dimInfo.type());
-        pos += dimInfo.size();
+        results->put(m_key, std::make_shared<const std::vector<char>>(m_data));
     }
 }
 
-} // namespace entwine
+void ReadQuery::run(const Callback& f, const std::size_t batchSize)
+{
+    m_batchSize = std::max<std::size_t>(batchSize, 1);
+    if (fromCache(f)) return;
+
+    m_callback = f;
+
+    m_data.clear();
+    m_data.reserve(
+            std::min<uint64_t>(m_batchSize, overlapped()) *
+            m_plan.dstPointSize());
+
+    try
+    {
+        Query::run();
+        flush();
+    }
+    catch (...)
+    {
+        m_callback = Callback();
+        throw;
+    }
+
+    m_callback = Callback();
+}
 
+void ReadQuery::process(const std::vector<const char*>& points)
+{
+    append(points.size(), [this, &points](
+                std::size_t offset,
+                std::size_t count,
+                char* dst)
+    {
+        m_plan.apply(points.data() + offset, dst, count);
+    });
+}
+
+bool ReadQuery::encode(
+        const std::vector<const char*>& points,
+        std::vector<char>& out) const
+{
+    if (m_encoder.binary()) return false;
+    out = m_encoder.encode(points);
+    return true;
+}
+
+bool ReadQuery::passthrough(const Dxyz& key, std::vector<char>& out) const
+{
+    if (!m_encoder.passthrough()) return false;
+
+    out = m_metadata.dataIo().stored(
+            m_reader.ep().getSubEndpoint("ept-data"),
+            m_reader.tmp(),
+            key.toString());
+    return true;
+}
+
+void ReadQuery::emit(const std::vector<char>& data, const uint64_t n)
+{
+    if (m_encoder.binary())
+    {
+        // Stored binary nodes, which are already in our layout.
+        const std::size_t pointSize(m_plan.dstPointSize());
+        append(n, [&data, pointSize](
+                    std::size_t offset,
+                    std::size_t count,
+                    char* dst)
+        {
+            const char* src(data.data() + offset * pointSize);
+            std::copy(src, src + count * pointSize, dst);
+        });
+        return;
+    }
+
+    // Other encodings are self-contained a node at a time, so they are
+    // never split into batches.
+    if (m_callback) m_callback(data.data(), data.size(), n);
+    else m_data.insert(m_data.end(), data.begin(), data.end());
+}
+
+void ReadQuery::append(const std::size_t n, const Write& write)
+{
+    const std::size_t pointSize(m_plan.dstPointSize());
+
+    if (!m_callback)
+    {
+        // Our hierarchy counts bound the size of the result, so allocate
+        // once up front rather than as each chunk arrives.  Since a filter
+        // may select few of those points, this is capped to a fixed size,
+        // beyond which the buffer grows as usual.
+        if (m_data.empty())
+        {
+            m_data.reserve(
+                    std::min<uint64_t>(
+                        overlapped() * pointSize,
+                        maxReserve / pointSize * pointSize));
+        }
+
+        const std::size_t size(m_data.size());
+        m_data.resize(size + n * pointSize);
+        write(0, n, m_data.data() + size);
+        return;
+    }
+
+    std::size_t offset(0);
+    while (offset < n)
+    {
+        const std::size_t size(m_data.size());
+        const std::size_t room(m_batchSize - size / pointSize);
+        const std::size_t count(std::min(room, n - offset));
+
+        m_data.resize(size + count * pointSize);
+        write(offset, count, m_data.data() + size);
+        offset += count;
+
+        if (count == room) flush();
+    }
+}
+
+void ReadQuery::completed(uint64_t depth)
+{
+    if (m_callback && reporting()) flush();
+}
+
+void ReadQuery::flush()
+{
+    if (m_data.empty()) return;
+
+    const std::size_t pointSize(m_plan.dstPointSize());
+    m_callback(m_data.data(), m_data.size(), m_data.size() / pointSize);
+    m_data.clear();
+}
+
+} // namespace entwine
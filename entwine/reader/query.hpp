@@ -10,12 +10,27 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
 #include <entwine/reader/query-params.hpp>
 
+#include <entwine/reader/encoder.hpp>
 #include <entwine/reader/filter.hpp>
 #include <entwine/reader/hierarchy-reader.hpp>
+#include <entwine/reader/level-of-detail.hpp>
 #include <entwine/reader/chunk-reader.hpp>
 #include <entwine/types/binary-point-table.hpp>
+#include <entwine/types/copy-plan.hpp>
 #include <entwine/types/key.hpp>
 #include <entwine/types/schema.hpp>
 
@@ -30,28 +45,151 @@ public:
     Query(const Reader& reader, const Json::Value& params);
     virtual ~Query() { }
 
-    void run();
+    // Nodes are processed in depth order, so a query which is stopped early,
+    // either by cancel() or by its "deadline", given in milliseconds from
+    // the start of run(), has selected points at the best resolution it
+    // could reach in the time allowed.  Nodes are selected entirely or not
+    // at all.  The nodes overlapped by the query are traversed, fetching
+    // whatever hierarchy is required, on the first call.
+    virtual void run();
+
+    // May be called from any thread while we run.
+    void cancel() { m_cancelled = true; }
+
+    // Called from run() as each depth completes, once the selected points
+    // of all of its nodes have been processed.
+    using DepthCallback = std::function<void(uint64_t depth)>;
+    void onDepth(const DepthCallback& f) { m_onDepth = f; }
 
     uint64_t points() const { return m_points; }
 
+    // False if we were stopped before selecting every point.
+    bool done() const { return m_done; }
+
+    // All nodes at depths in [depthBegin, satisfied) have been processed.
+    uint64_t satisfied() const;
+
 protected:
-    virtual void process(const pdal::PointRef& pr) { }
+    // Process the selected points of a single chunk, which are laid out
+    // according to the absolute schema of our metadata.
+    virtual void process(const std::vector<const char*>& points) { }
+
+    // The dimensions which must be read to run this query.
+    virtual std::set<std::string> dims() const;
+
+    // False if process() has no use for the selected points themselves,
+    // in which case nodes whose points are all selected are never read.
+    virtual bool materialize() const { return true; }
+
+    // Called on the pool of our reader, concurrently for different nodes,
+    // with the selected points of a node.  Returns true if they were
+    // consumed, in which case they are not passed to process().
+    virtual bool reduce(const std::vector<const char*>& points) const
+    {
+        return false;
+    }
+
+    // Called on the pool of our reader for a node of _count_ points, all of
+    // which are selected.  Returns true if they were accounted for without
+    // reading them, for example from the statistics of the node.
+    virtual bool summarize(const Dxyz& key, uint64_t count) const
+    {
+        return false;
+    }
+
+    // Called on the pool of our reader, concurrently for different nodes,
+    // with the selected points of a node.  Returns true if they were encoded
+    // into _out_, in which case _out_ is passed to emit() rather than the
+    // points to process().
+    virtual bool encode(
+            const std::vector<const char*>& points,
+            std::vector<char>& out) const
+    {
+        return false;
+    }
+
+    // Called on the pool of our reader for the node _key_, all of whose
+    // points are selected, before it is read.  Returns true if _out_ was set
+    // to their encoding without decoding them, for example from the stored
+    // data of the node.
+    virtual bool passthrough(const Dxyz& key, std::vector<char>& out) const
+    {
+        return false;
+    }
+
+    // Receives the encoding of _n_ selected points, in node order.
+    virtual void emit(const std::vector<char>& data, uint64_t n) { }
+
+    // Called before the callback passed to onDepth().
+    virtual void completed(uint64_t depth) { }
+
+    // True if a callback was passed to onDepth().
+    bool reporting() const { return !!m_onDepth; }
+
+    // The total point count of the nodes overlapped by this query, which is
+    // an upper bound on the number of points it may select.
+    uint64_t overlapped() const;
 
     const Reader& m_reader;
     const Metadata& m_metadata;
     const HierarchyReader& m_hierarchy;
     const QueryParams m_params;
     const Filter m_filter;
+    const LevelOfDetail m_lod;
+
+    uint64_t m_points = 0;
+    bool m_done = false;
 
 private:
-    HierarchyReader::Keys overlaps() const;
-    void overlaps(HierarchyReader::Keys& keys, const ChunkKey& c) const;
+    // An overlapped node, and which of our checks are known to pass for all
+    // of its points.
+    struct Overlap
+    {
+        uint64_t count = 0;
+        bool within = false;    // Entirely within the query bounds.
+        bool passes = false;    // Entirely passes the filter.
+    };
 
-    void maybeProcess(const pdal::PointRef& pr);
+    using Overlaps = std::map<Dxyz, Overlap>;
 
-    HierarchyReader::Keys m_overlaps;
-    uint64_t m_points = 0;
-    std::deque<SharedChunkReader> m_chunks;
+    // Our overlapped nodes, which are traversed when first required.
+    const Overlaps& overlaps() const;
+    Overlaps traverse() const;
+
+    // False if no point of _c_ can be selected.
+    bool visible(const ChunkKey& c) const;
+
+    // A chunk along with its points which pass our filter.  If the points
+    // were not materialized, only their count is known, along with their
+    // encoding if they were encoded.  Skipped if we were stopped before it
+    // was selected.
+    struct Selection
+    {
+        SharedChunkReader chunk;
+        std::vector<const char*> points;
+        std::vector<char> encoded;
+        uint64_t count = 0;
+        uint64_t depth = 0;
+        bool skipped = false;
+    };
+
+    Selection select(
+            const Dxyz& key,
+            const Overlap& overlap,
+            const std::set<std::string>& dims) const;
+
+    // True once we have been cancelled or our deadline has passed.
+    bool stopped() const;
+
+    mutable std::unique_ptr<Overlaps> m_overlaps;
+    const std::size_t m_prefetch;
+
+    using Clock = std::chrono::steady_clock;
+    const std::chrono::duration<double, std::milli> m_deadline;
+    Clock::time_point m_start;
+    std::atomic_bool m_cancelled { false };
+    uint64_t m_satisfied = 0;
+    DepthCallback m_onDepth;
 };
 
 class CountQuery : public Query
@@ -60,8 +198,16 @@ public:
     CountQuery(const Reader& reader, const Json::Value& json)
         : Query(reader, json)
     { }
+
+protected:
+    virtual bool materialize() const override { return false; }
 };
 
+// Points are output in the layout of the query "schema", or of the output
+// schema of the dataset if none is given, in the "encoding" given, which is
+// binary by default (see Encoder).  Other encodings are produced a node at
+// a time on the pool of our reader, and nodes whose stored data is already
+// in the requested encoding are output as stored, without being decoded.
 class ReadQuery : public Query
 {
 public:
@@ -69,53 +215,81 @@ public:
         : Query(reader, json)
         , m_schema(json.isMember("schema") ?
                 Schema(json["schema"]) : m_metadata.outSchema())
+        , m_plan(m_metadata.schema(), m_schema)
+        , m_encoder(m_metadata, m_schema, json["encoding"])
+        , m_key(key(reader, json))
     { }
 
+    // Receives _n_ points in _size_ bytes, which are only valid for the
+    // duration of the call.  If our encoding is binary, these are contiguous
+    // and laid out according to our schema, otherwise they are the
+    // self-contained encoding of the points of a single node.
+    using Callback = std::function<
+        void(const char* data, std::size_t size, std::size_t n)>;
+
+    // Read all selected points into our data buffer, as a concatenation of
+    // node encodings if our encoding is not binary.  If our reader has a
+    // result cache, the result of an equivalent query may be returned from it
+    // without reading any chunks, in which case no depths are reported.
+    // Results are only cached if they are binary and if we were not stopped
+    // early.  A cached result is found without traversing the hierarchy.
+    virtual void run() override;
+
+    // Stream the selected points to _f_ in batches of _batchSize_ points,
+    // except for the final batch which may be smaller, in node order as
+    // they are read.  Our data buffer is used only as staging for each
+    // batch, so memory use is bounded regardless of the result size.
+    //
+    // If a callback was passed to onDepth(), the batch is also flushed as
+    // each depth completes, before that callback, so that every reported
+    // depth has been received in full.  Batches ending a depth may then be
+    // smaller as well.
+    //
+    // Other encodings are passed to _f_ a node at a time regardless of
+    // _batchSize_.  Cached results are streamed, but results are not cached
+    // when streaming.
+    void run(const Callback& f, std::size_t batchSize = 65536);
+
+    const Schema& schema() const { return m_schema; }
+    const Encoder& encoder() const { return m_encoder; }
     const std::vector<char>& data() const { return m_data; }
 
 protected:
-    virtual void process(const pdal::PointRef& pr) override;
+    virtual void process(const std::vector<const char*>& points) override;
+    virtual std::set<std::string> dims() const override;
+    virtual void completed(uint64_t depth) override;
+
+    virtual bool encode(
+            const std::vector<const char*>& points,
+            std::vector<char>& out) const override;
+    virtual bool passthrough(const Dxyz& key, std::vector<char>& out) const
+        override;
+    virtual void emit(const std::vector<char>& data, uint64_t n) override;
 
 private:
-    void setAs(char* dst, double d, pdal::Dimension::Type t)
-    {
-        switch (t)
-        {
-            case pdal::Dimension::Type::Double:     setAs<double>(dst, d);
-                break;
-            case pdal::Dimension::Type::Float:      setAs<float>(dst, d);
-                break;
-            case pdal::Dimension::Type::Unsigned8:  setAs<uint8_t>(dst, d);
-                break;
-            case pdal::Dimension::Type::Signed8:    setAs<int8_t>(dst, d);
-                break;
-            case pdal::Dimension::Type::Unsigned16: setAs<uint16_t>(dst, d);
-                break;
-            case pdal::Dimension::Type::Signed16:   setAs<int16_t>(dst, d);
-                break;
-            case pdal::Dimension::Type::Unsigned32: setAs<uint32_t>(dst, d);
-                break;
-            case pdal::Dimension::Type::Signed32:   setAs<int32_t>(dst, d);
-                break;
-            case pdal::Dimension::Type::Unsigned64: setAs<uint64_t>(dst, d);
-                break;
-            case pdal::Dimension::Type::Signed64:   setAs<int64_t>(dst, d);
-                break;
-            default:
-                break;
-        }
-    }
+    // Append _n_ points in our binary layout, where _write_ writes _count_
+    // points, starting from the point at _offset_, to _dst_.
+    using Write = std::function<
+        void(std::size_t offset, std::size_t count, char* dst)>;
+    void append(std::size_t n, const Write& write);
 
-    template<typename T> void setAs(char* dst, double d)
-    {
-        const T v(static_cast<T>(d));
-        auto src(reinterpret_cast<const char*>(&v));
-        std::copy(src, src + sizeof(T), dst);
-    }
+    void flush();
+
+    // Empty if our result may not be cached.
+    std::string key(const Reader& reader, const Json::Value& json) const;
+
+    // Returns false if our result was not cached.
+    bool fromCache(const Callback& f);
 
     const Schema m_schema;
+    const CopyPlan m_plan;
+    const Encoder m_encoder;
+    const std::string m_key;
 
     std::vector<char> m_data;
+
+    Callback m_callback;
+    std::size_t m_batchSize = 0;
 };
 
 } // namespace entwine
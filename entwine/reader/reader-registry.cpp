@@ -0,0 +1,143 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/reader/reader-registry.hpp>
+
+#include <exception>
+#include <limits>
+#include <vector>
+
+#include <entwine/util/unique.hpp>
+
+namespace entwine
+{
+
+ReaderRegistry::ReaderRegistry(
+        const std::size_t maxBytes,
+        const std::size_t maxIdle,
+        const std::string tmp,
+        std::shared_ptr<arbiter::Arbiter> a,
+        const std::size_t threads)
+    : m_tmp(tmp)
+    , m_arbiter(maybeDefault(a))
+    , m_maxIdle(maxIdle)
+    , m_cache(std::make_shared<Cache>(maxBytes / 4 * 3))
+    , m_hierarchyCache(std::make_shared<HierarchyCache>(maxBytes / 8))
+    , m_results(std::make_shared<ResultCache>(maxBytes / 8))
+    , m_pool(std::make_shared<Pool>(
+                threads,
+                std::numeric_limits<std::size_t>::max(),
+                false))
+{ }
+
+std::shared_ptr<Reader> ReaderRegistry::get(const std::string& path)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    Entry& entry(m_readers[path]);
+    entry.used = ++m_tick;
+
+    if (entry.reader.valid())
+    {
+        const std::shared_future<SharedReader> reader(entry.reader);
+        lock.unlock();
+        return reader.get();
+    }
+
+    std::promise<SharedReader> promise;
+    entry.reader = promise.get_future().share();
+    lock.unlock();
+
+    SharedReader reader;
+
+    try
+    {
+        reader = std::make_shared<Reader>(
+                path,
+                m_tmp,
+                m_cache,
+                m_arbiter,
+                m_hierarchyCache,
+                m_pool);
+        reader->setResultCache(m_results);
+    }
+    catch (...)
+    {
+        // Waiters see the failure, and the next request tries again.
+        promise.set_exception(std::current_exception());
+        lock.lock();
+        m_readers.erase(path);
+        throw;
+    }
+
+    promise.set_value(reader);
+
+    lock.lock();
+    m_readers[path].open = true;
+    purge();
+
+    return reader;
+}
+
+bool ReaderRegistry::idle(const Entry& entry) const
+{
+    // Handles are only copied from ours with our lock held, so if ours is
+    // the only one then none can appear until we release it.
+    return entry.open && entry.reader.get().use_count() == 1;
+}
+
+void ReaderRegistry::purge()
+{
+    std::multimap<uint64_t, std::string> idlers;
+    for (const auto& p : m_readers)
+    {
+        if (idle(p.second)) idlers.emplace(p.second.used, p.first);
+    }
+
+    auto it(idlers.begin());
+    while (idlers.size() > m_maxIdle)
+    {
+        m_readers.erase(it->second);
+        it = idlers.erase(it);
+    }
+}
+
+std::size_t ReaderRegistry::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::size_t n(0);
+    for (const auto& p : m_readers) if (p.second.open) ++n;
+    return n;
+}
+
+std::size_t ReaderRegistry::idle() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::size_t n(0);
+    for (const auto& p : m_readers) if (idle(p.second)) ++n;
+    return n;
+}
+
+Json::Value ReaderRegistry::toJson() const
+{
+    Json::Value json;
+    json["readers"] = static_cast<Json::UInt64>(size());
+    json["idle"] = static_cast<Json::UInt64>(idle());
+    json["cache"] = m_cache->toJson();
+    json["hierarchyBytes"] =
+        static_cast<Json::UInt64>(m_hierarchyCache->size());
+    json["resultBytes"] = static_cast<Json::UInt64>(m_results->size());
+    return json;
+}
+
+} // namespace entwine
+
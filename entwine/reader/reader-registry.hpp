@@ -0,0 +1,102 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <json/json.h>
+
+#include <entwine/reader/cache.hpp>
+#include <entwine/reader/hierarchy-cache.hpp>
+#include <entwine/reader/reader.hpp>
+#include <entwine/reader/result-cache.hpp>
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/util/pool.hpp>
+
+namespace entwine
+{
+
+// Opens readers for any number of datasets, which share one chunk cache, one
+// hierarchy cache, and one result cache, so that a single memory budget
+// applies across all of them.  Of that budget, three quarters go to chunks
+// and an eighth each to hierarchy pages and query results.  Likewise they
+// share one pool of _threads_ on which their queries fetch chunks.
+//
+// Readers are opened on first use and handed out as shared handles.  A
+// reader for which no handles remain is idle, and beyond _maxIdle_ of these
+// the least recently used are closed, releasing their metadata and all of
+// their cached data.  Since handles may be dropped at any time, idle readers
+// are closed as other readers are requested.
+class ReaderRegistry
+{
+public:
+    ReaderRegistry(
+            std::size_t maxBytes = 1024 * 1024 * 512,   // 512 MB.
+            std::size_t maxIdle = 16,
+            std::string tmp = "",
+            std::shared_ptr<arbiter::Arbiter> a =
+                std::shared_ptr<arbiter::Arbiter>(),
+            std::size_t threads = 8);
+
+    // Returns the reader for the dataset at _path_, opening it if necessary.
+    // Concurrent requests for a dataset which is not open result in a single
+    // open, which the other requesters wait for.
+    std::shared_ptr<Reader> get(const std::string& path);
+
+    // The number of open readers, and the number of those which are idle.
+    std::size_t size() const;
+    std::size_t idle() const;
+
+    Cache& cache() const { return *m_cache; }
+    HierarchyCache& hierarchyCache() const { return *m_hierarchyCache; }
+    ResultCache& results() const { return *m_results; }
+    Pool& pool() const { return *m_pool; }
+
+    Json::Value toJson() const;
+
+private:
+    using SharedReader = std::shared_ptr<Reader>;
+
+    struct Entry
+    {
+        std::shared_future<SharedReader> reader;
+
+        // Until opened, an entry cannot be closed.
+        bool open = false;
+        uint64_t used = 0;
+    };
+
+    // With our lock held.
+    bool idle(const Entry& entry) const;
+    void purge();
+
+    const std::string m_tmp;
+    const std::shared_ptr<arbiter::Arbiter> m_arbiter;
+    const std::size_t m_maxIdle;
+
+    const std::shared_ptr<Cache> m_cache;
+    const std::shared_ptr<HierarchyCache> m_hierarchyCache;
+    const std::shared_ptr<ResultCache> m_results;
+    const std::shared_ptr<Pool> m_pool;
+
+    mutable std::mutex m_mutex;
+    std::map<std::string, Entry> m_readers;
+    uint64_t m_tick = 0;
+};
+
+} // namespace entwine
+
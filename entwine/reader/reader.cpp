@@ -10,25 +10,52 @@
 
 #include <entwine/reader/reader.hpp>
 
+#include <limits>
+
 #include <entwine/util/unique.hpp>
 
 namespace entwine
 {
 
+namespace
+{
+    const std::size_t poolThreads(8);
+
+    std::shared_ptr<Pool> globalPool()
+    {
+        static std::shared_ptr<Pool> pool(
+                std::make_shared<Pool>(
+                    poolThreads,
+                    std::numeric_limits<std::size_t>::max(),
+                    false));
+        return pool;
+    }
+}
+
 Reader::Reader(
         std::string out,
         std::string tmp,
         std::shared_ptr<Cache> cache,
-        std::shared_ptr<arbiter::Arbiter> a)
+        std::shared_ptr<arbiter::Arbiter> a,
+        std::shared_ptr<HierarchyCache> hierarchyCache,
+        std::shared_ptr<Pool> pool)
     : m_arbiter(maybeDefault(a))
     , m_ep(m_arbiter->getEndpoint(out))
     , m_tmp(m_arbiter->getEndpoint(
                 tmp.size() ? tmp : arbiter::fs::getTempPath()))
     , m_metadata(m_ep)
-    , m_hierarchy(m_ep)
-    , m_cache(makeUnique<Cache>())
+    , m_hierarchy(m_ep, m_metadata.nodeStats(), hierarchyCache)
+    , m_cache(cache ? cache : Cache::global())
+    , m_id(m_cache->attach())
+    , m_pool(pool ? pool : globalPool())
+    , m_dataset(ResultCache::dataset(path(), m_metadata))
 { }
 
+Reader::~Reader()
+{
+    m_cache->detach(m_id);
+}
+
 std::unique_ptr<CountQuery> Reader::count(const Json::Value& j) const
 {
     return makeUnique<CountQuery>(*this, j);
@@ -39,5 +66,10 @@ std::unique_ptr<ReadQuery> Reader::read(const Json::Value& j) const
     return makeUnique<ReadQuery>(*this, j);
 }
 
+std::unique_ptr<AggregateQuery> Reader::aggregate(const Json::Value& j) const
+{
+    return makeUnique<AggregateQuery>(*this, j);
+}
+
 } // namespace entwine
 
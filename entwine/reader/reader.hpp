@@ -13,13 +13,16 @@
 #include <memory>
 #include <string>
 
+#include <entwine/reader/aggregate-query.hpp>
 #include <entwine/reader/cache.hpp>
 #include <entwine/reader/hierarchy-reader.hpp>
 #include <entwine/reader/query.hpp>
+#include <entwine/reader/result-cache.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/types/key.hpp>
 #include <entwine/types/metadata.hpp>
 #include <entwine/util/json.hpp>
+#include <entwine/util/pool.hpp>
 
 namespace entwine
 {
@@ -27,15 +30,24 @@ namespace entwine
 class Reader
 {
 public:
+    // If no _cache_ is supplied, the global cache is used.  If no
+    // _hierarchyCache_ is supplied, hierarchy pages are cached by this reader
+    // alone.  If no _pool_ is supplied, a pool shared by all such readers in
+    // the process is used, so that their total concurrency is bounded.
     Reader(
             std::string out,
             std::string tmp = "",
             std::shared_ptr<Cache> cache = std::shared_ptr<Cache>(),
             std::shared_ptr<arbiter::Arbiter> a =
-                std::shared_ptr<arbiter::Arbiter>());
+                std::shared_ptr<arbiter::Arbiter>(),
+            std::shared_ptr<HierarchyCache> hierarchyCache =
+                std::shared_ptr<HierarchyCache>(),
+            std::shared_ptr<Pool> pool = std::shared_ptr<Pool>());
+    ~Reader();
 
     std::unique_ptr<CountQuery> count(const Json::Value& json) const;
     std::unique_ptr<ReadQuery> read(const Json::Value& json) const;
+    std::unique_ptr<AggregateQuery> aggregate(const Json::Value& json) const;
 
     const Metadata& metadata() const { return m_metadata; }
     const HierarchyReader& hierarchy() const { return m_hierarchy; }
@@ -43,6 +55,23 @@ public:
     const arbiter::Endpoint& tmp() const { return m_tmp; }
     Cache& cache() const { return *m_cache; }
 
+    // Read query results are only cached if a result cache is set, which may
+    // be shared with other readers.
+    void setResultCache(std::shared_ptr<ResultCache> results)
+    {
+        m_results = results;
+    }
+    ResultCache* results() const { return m_results.get(); }
+
+    // Identifies our dataset, including its version, within a result cache.
+    const std::string& dataset() const { return m_dataset; }
+
+    // The ID under which our chunks are cached.
+    uint64_t id() const { return m_id; }
+
+    // Worker threads on which queries fetch and decode their chunks.
+    Pool& pool() const { return *m_pool; }
+
     std::string path() const { return ep().prefixedRoot(); }
 
 private:
@@ -53,7 +82,12 @@ private:
     const Metadata m_metadata;
     const HierarchyReader m_hierarchy;
 
-    std::unique_ptr<Cache> m_cache;
+    std::shared_ptr<Cache> m_cache;
+    const uint64_t m_id;
+    std::shared_ptr<Pool> m_pool;
+
+    const std::string m_dataset;
+    std::shared_ptr<ResultCache> m_results;
 };
 
 } // namespace entwine
@@ -0,0 +1,184 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/reader/result-cache.hpp>
+
+#include <functional>
+
+#include <entwine/reader/comparison.hpp>
+#include <entwine/reader/logic-gate.hpp>
+#include <entwine/reader/query-params.hpp>
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/metadata.hpp>
+#include <entwine/types/schema.hpp>
+#include <entwine/util/json.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    // Numbers are compared by value, regardless of how they were written.
+    Json::Value normalize(const Json::Value& json)
+    {
+        if (json.isNumeric() && !json.isBool()) return json.asDouble();
+
+        Json::Value result(json);
+        if (json.isArray())
+        {
+            for (Json::ArrayIndex i(0); i < json.size(); ++i)
+            {
+                result[i] = normalize(json[i]);
+            }
+        }
+        else if (json.isObject())
+        {
+            for (const std::string& key : json.getMemberNames())
+            {
+                result[key] = normalize(json[key]);
+            }
+        }
+        return result;
+    }
+
+    // A bare value for a dimension is shorthand for an "$eq" comparison.
+    Json::Value canonicalFilter(const Json::Value& json)
+    {
+        if (!json.isObject()) return json;
+
+        Json::Value result(Json::objectValue);
+        for (const std::string& key : json.getMemberNames())
+        {
+            const Json::Value& val(json[key]);
+
+            if (isLogicalOperator(key))
+            {
+                Json::Value& list(result[key]);
+                list = Json::arrayValue;
+                for (const Json::Value& f : val)
+                {
+                    list.append(canonicalFilter(f));
+                }
+            }
+            else if (val.isObject()) result[key] = val;
+            else result[key]["$eq"] = val;
+        }
+        return result;
+    }
+}
+
+ResultCache::ResultCache(const std::size_t maxBytes)
+    : m_maxBytes(maxBytes)
+{ }
+
+std::string ResultCache::dataset(const std::string& path, const Metadata& m)
+{
+    const std::size_t h(std::hash<std::string>()(toFastString(m.toJson())));
+    return path + "@" + std::to_string(h);
+}
+
+std::string ResultCache::key(
+        const std::string& dataset,
+        const Json::Value& json)
+{
+    Json::Value q(json.isObject() ? json : Json::Value(Json::objectValue));
+
+    // Only affect how the query runs, not its result, since results of
+    // queries which were stopped early are not cached.
+    q.removeMember("prefetch");
+    q.removeMember("deadline");
+
+    // Only binary results are cached, which is the default.
+    q.removeMember("encoding");
+
+    const QueryParams params(q);
+    q.removeMember("depth");
+    q["depthBegin"] = static_cast<Json::UInt64>(params.db());
+    q["depthEnd"] = static_cast<Json::UInt64>(params.de());
+
+    if (q.isMember("bounds")) q["bounds"] = Bounds(q["bounds"]).toJson();
+    if (q.isMember("filter")) q["filter"] = canonicalFilter(q["filter"]);
+    if (q.isMember("schema")) q["schema"] = Schema(q["schema"]).toJson();
+
+    // Object members are serialized in sorted order.
+    return dataset + "\n" + toFastString(normalize(q));
+}
+
+ResultCache::Result ResultCache::get(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto it(m_entries.find(key));
+    if (it == m_entries.end())
+    {
+        ++m_stats.misses;
+        return Result();
+    }
+
+    ++m_stats.hits;
+    Entry& entry(it->second);
+    m_order.splice(m_order.begin(), m_order, entry.it);
+    return entry.result;
+}
+
+void ResultCache::put(const std::string& key, const Result result)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (result->size() > m_maxBytes || m_entries.count(key)) return;
+
+    m_order.push_front(key);
+
+    Entry& entry(m_entries[key]);
+    entry.result = result;
+    entry.it = m_order.begin();
+    m_size += result->size();
+
+    purge();
+}
+
+void ResultCache::purge()
+{
+    while (m_size > m_maxBytes && !m_order.empty())
+    {
+        const auto victim(m_entries.find(m_order.back()));
+        m_size -= victim->second.result->size();
+        m_entries.erase(victim);
+        m_order.pop_back();
+    }
+}
+
+std::size_t ResultCache::maxBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_maxBytes;
+}
+
+void ResultCache::setMaxBytes(const std::size_t maxBytes)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_maxBytes = maxBytes;
+    purge();
+}
+
+ResultCache::Stats ResultCache::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+std::size_t ResultCache::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_size;
+}
+
+} // namespace entwine
+
@@ -0,0 +1,89 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <json/json.h>
+
+namespace entwine
+{
+
+class Metadata;
+
+// Holds the results of read queries, keyed on a canonical form of their
+// parameters, so that identical queries may be answered without reading any
+// chunks.  Results are evicted in least recently used order to stay within a
+// size budget.  A result cache may be shared by any number of readers, whose
+// keys include the path and the metadata of their datasets, so results of a
+// dataset which has since changed are never returned.
+class ResultCache
+{
+public:
+    using Result = std::shared_ptr<const std::vector<char>>;
+
+    ResultCache(std::size_t maxBytes = 1024 * 1024 * 64);  // 64 MB.
+
+    // Returns null if _key_ is not cached.
+    Result get(const std::string& key);
+
+    // Results larger than our entire budget are not cached.
+    void put(const std::string& key, Result result);
+
+    // A canonical form of the read query _json_, for which equivalent
+    // queries are identical, prefixed by _dataset_.
+    static std::string key(
+            const std::string& dataset,
+            const Json::Value& json);
+
+    // Identifies the dataset at _path_ with _metadata_.
+    static std::string dataset(
+            const std::string& path,
+            const Metadata& metadata);
+
+    std::size_t maxBytes() const;
+    void setMaxBytes(std::size_t maxBytes);
+
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    Stats stats() const;
+    std::size_t size() const;
+
+private:
+    struct Entry
+    {
+        Result result;
+        std::list<std::string>::iterator it;
+    };
+
+    void purge();
+
+    mutable std::mutex m_mutex;
+    std::size_t m_maxBytes;
+    std::size_t m_size = 0;
+    std::map<std::string, Entry> m_entries;
+    std::list<std::string> m_order;
+    Stats m_stats;
+};
+
+} // namespace entwine
+
@@ -0,0 +1,313 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/types/copy-plan.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace entwine
+{
+
+namespace
+{
+
+const uint64_t batchSize(256);
+using Values = std::array<double, batchSize>;
+
+// Source point accessors, for contiguous and referenced points.
+struct Contiguous
+{
+    const char* operator()(uint64_t i) const { return data + i * pointSize; }
+
+    const char* data;
+    std::size_t pointSize;
+};
+
+struct Referenced
+{
+    const char* operator()(uint64_t i) const { return refs[i]; }
+
+    const char* const* refs;
+};
+
+template<typename T, typename Src>
+void readAs(Src src, std::size_t pos, uint64_t np, Values& values)
+{
+    T v;
+    for (uint64_t i(0); i < np; ++i)
+    {
+        std::memcpy(&v, src(i) + pos, sizeof(T));
+        values[i] = static_cast<double>(v);
+    }
+}
+
+template<typename Src>
+void read(Src src, std::size_t pos, DimType type, uint64_t np, Values& values)
+{
+    switch (type)
+    {
+        case DimType::Signed8:      readAs<int8_t>(src, pos, np, values);
+            break;
+        case DimType::Signed16:     readAs<int16_t>(src, pos, np, values);
+            break;
+        case DimType::Signed32:     readAs<int32_t>(src, pos, np, values);
+            break;
+        case DimType::Signed64:     readAs<int64_t>(src, pos, np, values);
+            break;
+        case DimType::Unsigned8:    readAs<uint8_t>(src, pos, np, values);
+            break;
+        case DimType::Unsigned16:   readAs<uint16_t>(src, pos, np, values);
+            break;
+        case DimType::Unsigned32:   readAs<uint32_t>(src, pos, np, values);
+            break;
+        case DimType::Unsigned64:   readAs<uint64_t>(src, pos, np, values);
+            break;
+        case DimType::Float:        readAs<float>(src, pos, np, values);
+            break;
+        case DimType::Double:       readAs<double>(src, pos, np, values);
+            break;
+        default: throw std::runtime_error("Invalid dimension type");
+    }
+}
+
+// Returns false if any value is not representable as a T.
+template<typename T>
+bool writeAs(
+        const Values& values,
+        char* dst,
+        std::size_t pointSize,
+        std::size_t pos,
+        uint64_t np)
+{
+    bool valid(true);
+
+    if (std::is_integral<T>::value)
+    {
+        // The exclusive upper bound is a power of two, so it is exact as a
+        // double, as is the lower bound.  NaNs fail these comparisons.
+        const double lo(std::numeric_limits<T>::lowest());
+        const double hi(std::ldexp(1.0, std::numeric_limits<T>::digits));
+
+        for (uint64_t i(0); i < np; ++i)
+        {
+            valid &= values[i] >= lo && values[i] < hi;
+        }
+
+        if (!valid) return false;
+    }
+
+    T v;
+    for (uint64_t i(0); i < np; ++i)
+    {
+        v = static_cast<T>(values[i]);
+        std::memcpy(dst + i * pointSize + pos, &v, sizeof(T));
+    }
+
+    return true;
+}
+
+bool write(
+        const Values& values,
+        char* dst,
+        std::size_t pointSize,
+        std::size_t pos,
+        DimType type,
+        uint64_t np)
+{
+    switch (type)
+    {
+        case DimType::Signed8:
+            return writeAs<int8_t>(values, dst, pointSize, pos, np);
+        case DimType::Signed16:
+            return writeAs<int16_t>(values, dst, pointSize, pos, np);
+        case DimType::Signed32:
+            return writeAs<int32_t>(values, dst, pointSize, pos, np);
+        case DimType::Signed64:
+            return writeAs<int64_t>(values, dst, pointSize, pos, np);
+        case DimType::Unsigned8:
+            return writeAs<uint8_t>(values, dst, pointSize, pos, np);
+        case DimType::Unsigned16:
+            return writeAs<uint16_t>(values, dst, pointSize, pos, np);
+        case DimType::Unsigned32:
+            return writeAs<uint32_t>(values, dst, pointSize, pos, np);
+        case DimType::Unsigned64:
+            return writeAs<uint64_t>(values, dst, pointSize, pos, np);
+        case DimType::Float:
+            return writeAs<float>(values, dst, pointSize, pos, np);
+        case DimType::Double:
+            return writeAs<double>(values, dst, pointSize, pos, np);
+        default: throw std::runtime_error("Invalid dimension type");
+    }
+}
+
+bool isIntegral(DimType type)
+{
+    return pdal::Dimension::base(type) != pdal::Dimension::BaseType::Floating;
+}
+
+} // unnamed namespace
+
+CopyPlan::CopyPlan(const Schema& src, const Schema& dst)
+    : m_srcPointSize(src.pointSize())
+    , m_dstPointSize(dst.pointSize())
+{
+    compile(src, dst, nullptr);
+}
+
+CopyPlan::CopyPlan(
+        const Schema& src,
+        const Schema& dst,
+        const std::set<std::string>& dims)
+    : m_srcPointSize(src.pointSize())
+    , m_dstPointSize(dst.pointSize())
+{
+    compile(src, dst, &dims);
+}
+
+void CopyPlan::compile(
+        const Schema& src,
+        const Schema& dst,
+        const std::set<std::string>* dims)
+{
+    std::size_t dstPos(0);
+
+    for (const DimInfo& d : dst.dims())
+    {
+        if (dims && !dims->count(d.name()))
+        {
+            dstPos += d.size();
+            continue;
+        }
+
+        if (!src.contains(d.name()))
+        {
+            if (!m_zeroes.empty() &&
+                    m_zeroes.back().dstPos + m_zeroes.back().size == dstPos)
+            {
+                m_zeroes.back().size += d.size();
+            }
+            else m_zeroes.push_back(Zero { dstPos, d.size() });
+
+            dstPos += d.size();
+            continue;
+        }
+
+        std::size_t srcPos(0);
+        for (const DimInfo& s : src.dims())
+        {
+            if (s.name() == d.name()) break;
+            srcPos += s.size();
+        }
+
+        const DimInfo& s(src.find(d.name()));
+
+        if (s.type() == d.type() &&
+                s.scale() == d.scale() &&
+                s.offset() == d.offset())
+        {
+            // Extend the previous run if this dimension follows it in both
+            // layouts.
+            if (!m_copies.empty() &&
+                    m_copies.back().srcPos + m_copies.back().size == srcPos &&
+                    m_copies.back().dstPos + m_copies.back().size == dstPos)
+            {
+                m_copies.back().size += d.size();
+            }
+            else m_copies.push_back(Copy { srcPos, dstPos, d.size() });
+        }
+        else
+        {
+            m_converts.push_back(
+                    Convert {
+                        d.name(),
+                        srcPos, s.type(), s.scale(), s.offset(),
+                        dstPos, d.type(), d.scale(), d.offset() });
+        }
+
+        dstPos += d.size();
+    }
+}
+
+template<typename Src>
+void CopyPlan::run(const Src src, char* dst, const uint64_t np) const
+{
+    Values values;
+
+    for (uint64_t begin(0); begin < np; begin += batchSize)
+    {
+        const uint64_t n(std::min(batchSize, np - begin));
+        const auto at([&src, begin](uint64_t i) { return src(begin + i); });
+        char* out(dst + begin * m_dstPointSize);
+
+        for (const Copy& c : m_copies)
+        {
+            for (uint64_t i(0); i < n; ++i)
+            {
+                std::memcpy(
+                        out + i * m_dstPointSize + c.dstPos,
+                        at(i) + c.srcPos,
+                        c.size);
+            }
+        }
+
+        for (const Zero& z : m_zeroes)
+        {
+            for (uint64_t i(0); i < n; ++i)
+            {
+                std::memset(out + i * m_dstPointSize + z.dstPos, 0, z.size);
+            }
+        }
+
+        for (const Convert& c : m_converts)
+        {
+            read(at, c.srcPos, c.srcType, n, values);
+
+            // Transform through the absolute value.
+            for (uint64_t i(0); i < n; ++i)
+            {
+                values[i] = (values[i] * c.srcScale + c.srcOffset -
+                        c.dstOffset) / c.dstScale;
+            }
+
+            if (isIntegral(c.dstType))
+            {
+                for (uint64_t i(0); i < n; ++i)
+                {
+                    values[i] = std::round(values[i]);
+                }
+            }
+
+            if (!write(values, out, m_dstPointSize, c.dstPos, c.dstType, n))
+            {
+                throw std::runtime_error(
+                        "Value out of range for dimension " + c.name);
+            }
+        }
+    }
+}
+
+void CopyPlan::apply(const char* src, char* dst, const uint64_t np) const
+{
+    run(Contiguous { src, m_srcPointSize }, dst, np);
+}
+
+void CopyPlan::apply(const char* const* src, char* dst, const uint64_t np)
+    const
+{
+    run(Referenced { src }, dst, np);
+}
+
+} // namespace entwine
@@ -0,0 +1,101 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <entwine/types/schema.hpp>
+
+namespace entwine
+{
+
+// A precompiled conversion of points from one schema's layout to another's.
+// Dimensions are matched by name.  Runs of identically typed, unscaled
+// dimensions which are contiguous in both layouts are copied verbatim, while
+// the rest are converted a dimension at a time over batches of points.
+//
+// Scaled dimensions pass through their absolute values, so for example XYZ
+// may be scaled from an absolute schema into a scaled one, and vice versa.
+// Conversions to integral types are rounded.  Dimensions of the destination
+// which do not exist in the source are zero-filled.
+class CopyPlan
+{
+public:
+    CopyPlan(const Schema& src, const Schema& dst);
+
+    // Convert only the dimensions named in _dims_, leaving the remainder of
+    // each destination point untouched.
+    CopyPlan(
+            const Schema& src,
+            const Schema& dst,
+            const std::set<std::string>& dims);
+
+    std::size_t srcPointSize() const { return m_srcPointSize; }
+    std::size_t dstPointSize() const { return m_dstPointSize; }
+
+    // Convert _np_ contiguous points from _src_ to _dst_.  These regions must
+    // not overlap.
+    void apply(const char* src, char* dst, uint64_t np) const;
+
+    // Convert the _np_ points referenced by _src_ to contiguous points at
+    // _dst_.
+    void apply(const char* const* src, char* dst, uint64_t np) const;
+
+private:
+    // Byte positions are relative to the start of each point.
+    struct Copy
+    {
+        std::size_t srcPos;
+        std::size_t dstPos;
+        std::size_t size;
+    };
+
+    struct Convert
+    {
+        std::string name;
+
+        std::size_t srcPos;
+        DimType srcType;
+        double srcScale;
+        double srcOffset;
+
+        std::size_t dstPos;
+        DimType dstType;
+        double dstScale;
+        double dstOffset;
+    };
+
+    struct Zero
+    {
+        std::size_t dstPos;
+        std::size_t size;
+    };
+
+    void compile(
+            const Schema& src,
+            const Schema& dst,
+            const std::set<std::string>* dims);
+
+    template<typename Src> void run(Src src, char* dst, uint64_t np) const;
+
+    std::size_t m_srcPointSize;
+    std::size_t m_dstPointSize;
+
+    std::vector<Copy> m_copies;
+    std::vector<Convert> m_converts;
+    std::vector<Zero> m_zeroes;
+};
+
+} // namespace entwine
@@ -28,6 +28,8 @@ namespace entwine
 namespace
 {
 
+const uint64_t sourcesStep(100);
+
 std::string idFrom(std::string path)
 {
     return arbiter::util::getBasename(path);
@@ -35,8 +37,9 @@ std::string idFrom(std::string path)
 
 } // unnamed namespace
 
-Files::Files(const FileInfoList& files)
+Files::Files(const FileInfoList& files, const std::size_t persisted)
     : m_files(files)
+    , m_persisted(std::min(persisted, files.size()))
 {
     // Aggregate statuses.
     for (const auto& f : m_files)
@@ -45,6 +48,11 @@ Files::Files(const FileInfoList& files)
         addStatus(f.status());
     }
 
+    identify();
+}
+
+void Files::identify()
+{
     // Initialize origin info for detailed metadata storage purposes.
     for (uint64_t i(0); i < m_files.size(); ++i)
     {
@@ -60,8 +68,6 @@ Files::Files(const FileInfoList& files)
     // If the basenames of all files are unique amongst one-another, then use
     // the basename as the ID for detailed metadata storage.  Otherwise use the
     // full file path.
-    const uint64_t sourcesStep(100);
-
     bool unique(true);
     std::set<std::string> basenames;
     for (const FileInfo& f : list())
@@ -75,14 +81,22 @@ Files::Files(const FileInfoList& files)
         else basenames.insert(id);
     }
 
-    if (unique)
+    for (uint64_t i(0); i < m_files.size(); ++i)
     {
-        for (uint64_t i(0); i < m_files.size(); ++i)
+        const FileInfo& f(m_files[i]);
+        const std::string id(unique ? idFrom(f.path()) : f.path());
+        const std::string url(
+                std::to_string(i / sourcesStep * sourcesStep) + ".json");
+
+        // If the storage location of previously written metadata has
+        // changed, then none of it may be treated as persisted.
+        if (i < m_persisted && (f.id() != id || f.url() != url))
         {
-            const FileInfo& f(m_files[i]);
-            f.setId(idFrom(f.path()));
-            f.setUrl(std::to_string(i / sourcesStep * sourcesStep) + ".json");
+            m_persisted = 0;
         }
+
+        f.setId(id);
+        f.setUrl(url);
     }
 }
 
@@ -152,8 +166,23 @@ void Files::writeFull(
     Pool pool(config.totalThreads());
 
     std::map<std::string, Json::Value> meta;
-    for (const auto& f : m_files)
+
+    // Detailed metadata is immutable once written, so for continued builds we
+    // only need to write the files which contain newly appended entries.  The
+    // persisted entries of those files are merged from the existing output
+    // since we haven't woken up their detailed metadata.
+    for (Origin o(m_persisted); o < m_files.size(); ++o)
     {
+        const FileInfo& f(m_files[o]);
+        if (!meta.count(f.url()))
+        {
+            const bool exists(o / sourcesStep * sourcesStep < m_persisted);
+
+            meta[f.url()] = exists ?
+                parse(ensureGetString(ep, f.url())) :
+                Json::Value(Json::objectValue);
+        }
+
         meta[f.url()][f.id()] = f.toFullJson();
     }
 
@@ -175,7 +204,18 @@ void Files::writeFull(
 void Files::append(const FileInfoList& fileInfo)
 {
     FileInfoList adding(diff(fileInfo));
-    for (const auto& f : adding) m_files.emplace_back(f);
+
+    // If an appended file shares a basename with an existing one, then all
+    // IDs change to full paths and identify() treats nothing as persisted,
+    // so the caller must have woken up all detailed metadata (see Metadata).
+    for (const auto& f : adding)
+    {
+        m_pointStats += f.pointStats();
+        addStatus(f.status());
+        m_files.emplace_back(f);
+    }
+
+    identify();
 }
 
 FileInfoList Files::diff(const FileInfoList& in) const
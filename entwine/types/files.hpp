@@ -34,7 +34,11 @@ class Pool;
 class Files
 {
 public:
-    Files(const FileInfoList& files);
+    // The first _persisted_ entries of _files_ are those whose detailed
+    // metadata already exists at the output, for example when continuing a
+    // build.  Only the detailed metadata containing other entries will be
+    // rewritten during saving.
+    Files(const FileInfoList& files, std::size_t persisted = 0);
     Files(const Json::Value& json) : Files(toFileInfo(json)) { }
 
     static FileInfoList extract(
@@ -49,6 +53,7 @@ public:
             bool primary) const;
 
     std::size_t size() const { return m_files.size(); }
+    std::size_t persisted() const { return m_persisted; }
 
     Origin find(const std::string& p) const
     {
@@ -124,6 +129,9 @@ public:
     }
 
 private:
+    // Assign origins, and IDs and URLs for detailed metadata storage.
+    void identify();
+
     void writeList(const arbiter::Endpoint& ep, const std::string& postfix)
         const;
 
@@ -141,6 +149,7 @@ private:
     }
 
     FileInfoList m_files;
+    std::size_t m_persisted = 0;
 
     mutable std::mutex m_mutex;
     PointStats m_pointStats;
@@ -35,7 +35,10 @@ Metadata::Metadata(const Config& config, const bool exists)
                     Bounds(config["bounds"]) :
                     makeCube(*m_boundsConforming)))
     , m_files(makeUnique<Files>(config.input()))
-    , m_dataIo(DataIo::create(*this, config.dataType()))
+    , m_dataIo(DataIo::create(
+                *this,
+                config.dataType(),
+                config["dataOptions"]))
     , m_reprojection(Reprojection::create(config["reprojection"]))
     , m_eptVersion(exists ?
             makeUnique<Version>(config["version"].asString()) :
@@ -43,6 +46,7 @@ Metadata::Metadata(const Config& config, const bool exists)
     , m_srs(makeUnique<Srs>(config.srs()))
     , m_subset(Subset::create(*this, config["subset"]))
     , m_trustHeaders(config.trustHeaders())
+    , m_nodeStats(!exists || config["nodeStats"].asBool())
     , m_ticks(config.ticks())
     , m_startDepth(std::log2(m_ticks))
     , m_sharedDepth(m_subset ? m_subset->splits() : 0)
@@ -54,6 +58,13 @@ Metadata::Metadata(const Config& config, const bool exists)
         throw std::runtime_error("Invalid ticks");
     }
 
+    // Subset builds write their shared nodes separately, and are merged by
+    // reading each other's nodes, which packing does not support.
+    if (m_subset && m_dataIo->packed())
+    {
+        throw std::runtime_error("Packed data cannot be used with subsets");
+    }
+
     if (m_outSchema->isScaled())
     {
         const Scale scale(m_outSchema->scale());
@@ -101,9 +112,23 @@ Metadata::Metadata(const arbiter::Endpoint& ep, const Config& config)
                     parse(ep.get("ept-build" + config.postfix() + ".json")))),
             true)
 {
-    Files files(Files::extract(ep, primary(), config.postfix()));
-    files.append(m_files->list());
-    m_files = makeUnique<Files>(files.list());
+    // Detailed source metadata doesn't change after it's written, so to
+    // continue a build we only need the sparse list - unless the appended
+    // files change where that detailed metadata lives, in which case we need
+    // to wake it all up so it can be rewritten.
+    const FileInfoList existing(Files::extract(ep, false, config.postfix()));
+
+    FileInfoList list(existing);
+    const FileInfoList added(Files(existing).diff(m_files->list()));
+    list.insert(list.end(), added.begin(), added.end());
+    m_files = makeUnique<Files>(list, existing.size());
+
+    if (primary() && m_files->persisted() < existing.size())
+    {
+        Files full(Files::extract(ep, true, config.postfix()));
+        full.append(m_files->list());
+        m_files = makeUnique<Files>(full.list());
+    }
 }
 
 Metadata::~Metadata() { }
@@ -131,9 +156,13 @@ Json::Value Metadata::toBuildParamsJson() const
 
     json["version"] = currentEntwineVersion().toString();
     json["trustHeaders"] = m_trustHeaders;
+    json["nodeStats"] = m_nodeStats;
     json["overflowDepth"] = (Json::UInt64)m_overflowDepth;
     json["overflowThreshold"] = (Json::UInt64)m_overflowThreshold;
     json["software"] = "Entwine";
+
+    const Json::Value dataOptions(m_dataIo->toJson());
+    if (!dataOptions.isNull()) json["dataOptions"] = dataOptions;
     if (m_subset) json["subset"] = m_subset->toJson();
     if (m_reprojection) json["reprojection"] = m_reprojection->toJson();
 
@@ -73,6 +73,10 @@ public:
     const Srs& srs() const { return *m_srs; }
 
     bool trustHeaders() const { return m_trustHeaders; }
+
+    // True if every hierarchy page has node statistics written alongside it,
+    // which is not the case for indexes built before they were recorded.
+    bool nodeStats() const { return m_nodeStats; }
     bool primary() const { return !m_subset || m_subset->primary(); }
 
     uint64_t ticks() const { return m_ticks; }
@@ -112,6 +116,7 @@ private:
     std::unique_ptr<Subset> m_subset;
 
     const bool m_trustHeaders = true;
+    bool m_nodeStats = true;
 
     const uint64_t m_ticks;
     const uint64_t m_startDepth;
@@ -0,0 +1,189 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/types/node-stats.hpp>
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#include <entwine/types/schema.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    // Values must be appended in ascending order.
+    void append(std::vector<NodeStats::Run>& runs, const double v)
+    {
+        if (!runs.empty() && runs.back().second + 1 == v)
+        {
+            runs.back().second = v;
+        }
+        else runs.emplace_back(v, v);
+    }
+
+    // The values of 8-bit dimensions are always tracked, offset to be
+    // non-negative, and those of other integral dimensions only if _track_ is
+    // set.
+    template<typename T>
+    NodeStats::Dim summarize(
+            const std::vector<char*>& points,
+            const std::size_t pos,
+            bool track)
+    {
+        const bool small(sizeof(T) == 1);
+        const int shift(std::is_signed<T>::value ? 128 : 0);
+        track = small || (track && std::is_integral<T>::value);
+
+        std::bitset<256> seen;
+        std::vector<T> values;
+
+        T lo(std::numeric_limits<T>::max());
+        T hi(std::numeric_limits<T>::lowest());
+        double sum(0);
+
+        T v;
+        for (const char* p : points)
+        {
+            std::memcpy(&v, p + pos, sizeof(T));
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+            sum += v;
+
+            if (!track) continue;
+            if (small) seen.set(static_cast<int>(v) + shift);
+            else if (values.empty() || values.back() != v) values.push_back(v);
+        }
+
+        NodeStats::Dim dim;
+        dim.min = static_cast<double>(lo);
+        dim.max = static_cast<double>(hi);
+        dim.sum = sum;
+
+        if (small)
+        {
+            for (std::size_t i(0); i < seen.size(); ++i)
+            {
+                if (seen.test(i)) append(dim.runs, int(i) - shift);
+            }
+        }
+        else if (track)
+        {
+            std::sort(values.begin(), values.end());
+            values.erase(
+                    std::unique(values.begin(), values.end()),
+                    values.end());
+
+            for (const T u : values) append(dim.runs, static_cast<double>(u));
+        }
+
+        return dim;
+    }
+
+    NodeStats::Dim summarize(
+            const std::vector<char*>& pts,
+            const std::size_t pos,
+            const DimType type,
+            const bool t)
+    {
+        switch (type)
+        {
+            case DimType::Signed8:    return summarize<int8_t>(pts, pos, t);
+            case DimType::Signed16:   return summarize<int16_t>(pts, pos, t);
+            case DimType::Signed32:   return summarize<int32_t>(pts, pos, t);
+            case DimType::Signed64:   return summarize<int64_t>(pts, pos, t);
+            case DimType::Unsigned8:  return summarize<uint8_t>(pts, pos, t);
+            case DimType::Unsigned16: return summarize<uint16_t>(pts, pos, t);
+            case DimType::Unsigned32: return summarize<uint32_t>(pts, pos, t);
+            case DimType::Unsigned64: return summarize<uint64_t>(pts, pos, t);
+            case DimType::Float:      return summarize<float>(pts, pos, t);
+            case DimType::Double:     return summarize<double>(pts, pos, t);
+            default: throw std::runtime_error("Invalid dimension type");
+        }
+    }
+}
+
+NodeStats::NodeStats(const Schema& schema, const std::vector<char*>& points)
+{
+    if (points.empty()) return;
+
+    const pdal::PointLayout& layout(schema.pdalLayout());
+    for (const auto& d : schema.dims())
+    {
+        // The origins present in each node are tracked so that queries for
+        // particular sources need only read the nodes which contain them.
+        m_dims[d.name()] = summarize(
+                points,
+                layout.dimOffset(d.id()),
+                layout.dimType(d.id()),
+                d.name() == "OriginId");
+    }
+}
+
+NodeStats::NodeStats(const Json::Value& json)
+{
+    for (const std::string& name : json.getMemberNames())
+    {
+        const Json::Value& j(json[name]);
+
+        Dim& dim(m_dims[name]);
+        dim.min = j[0].asDouble();
+        dim.max = j[1].asDouble();
+        dim.sum = j[2].asDouble();
+
+        for (const Json::Value& r : j[3])
+        {
+            const Json::Value& first(r.isArray() ? r[0] : r);
+            const Json::Value& last(r.isArray() ? r[1] : r);
+            dim.runs.emplace_back(first.asDouble(), last.asDouble());
+        }
+    }
+}
+
+Json::Value NodeStats::toJson() const
+{
+    Json::Value json(Json::objectValue);
+
+    for (const auto& p : m_dims)
+    {
+        const Dim& dim(p.second);
+
+        Json::Value& j(json[p.first]);
+        j.append(dim.min);
+        j.append(dim.max);
+        j.append(dim.sum);
+
+        if (!dim.runs.empty())
+        {
+            Json::Value& runs(j[3]);
+            for (const Run& r : dim.runs)
+            {
+                if (r.first == r.second) runs.append(r.first);
+                else
+                {
+                    Json::Value& run(runs.append(Json::arrayValue));
+                    run.append(r.first);
+                    run.append(r.second);
+                }
+            }
+        }
+    }
+
+    return json;
+}
+
+} // namespace entwine
+
@@ -0,0 +1,72 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <json/json.h>
+
+namespace entwine
+{
+
+class Schema;
+
+// The range and sum of each dimension over the points of a single node, and
+// for 8-bit dimensions and the OriginId, the set of values which occur.
+// These are recorded as nodes are written so that readers may skip nodes
+// whose points can't pass a filter without fetching them, or summarize nodes
+// without reading them.
+class NodeStats
+{
+public:
+    // An inclusive run of consecutive integer values, all of which occur.
+    using Run = std::pair<double, double>;
+
+    struct Dim
+    {
+        double min = 0;
+        double max = 0;
+        double sum = 0;
+
+        // Sorted and disjoint.  Empty unless the values of this dimension
+        // are tracked.
+        std::vector<Run> runs;
+    };
+
+    NodeStats() { }
+    explicit NodeStats(const Json::Value& json);
+
+    // The _points_ are laid out according to _schema_.
+    NodeStats(const Schema& schema, const std::vector<char*>& points);
+
+    // Returns null if _name_ was not recorded.
+    const Dim* find(const std::string& name) const
+    {
+        const auto it(m_dims.find(name));
+        return it != m_dims.end() ? &it->second : nullptr;
+    }
+
+    bool empty() const { return m_dims.empty(); }
+
+    // Each dimension is serialized as [min, max, sum], followed by [runs] if
+    // its values are tracked, where a run of a single value is serialized as
+    // that value and any other as [first, last].
+    Json::Value toJson() const;
+
+private:
+    std::map<std::string, Dim> m_dims;
+};
+
+} // namespace entwine
+
@@ -85,6 +85,11 @@ public:
         m_refs.insert(m_refs.end(), b.refs().begin(), b.refs().end());
     }
 
+    BlockPointTable(const Schema& schema, std::vector<char*> refs)
+        : SimplePointTable(schema.pdalLayout())
+        , m_refs(std::move(refs))
+    { }
+
     virtual char* getPoint(pdal::PointId index) override
     {
         return m_refs[index];
@@ -93,6 +98,7 @@ public:
     virtual pdal::PointId addPoint() override { return m_index++; }
     virtual bool supportsView() const override { return true; }
     uint64_t size() const { return m_refs.size(); }
+    const std::vector<char*>& refs() const { return m_refs; }
 
 private:
     std::vector<char*> m_refs;
@@ -0,0 +1,88 @@
+/******************************************************************************
+* Copyright (c) 2018, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace entwine
+{
+
+// Retains released buffers, up to a total capacity, so that their storage
+// may be reused by later acquisitions rather than reallocated.
+class BufferPool
+{
+public:
+    BufferPool(std::size_t maxBytes = 1024 * 1024 * 64)    // 64 MB.
+        : m_maxBytes(maxBytes)
+    { }
+
+    static BufferPool& instance()
+    {
+        static BufferPool pool;
+        return pool;
+    }
+
+    // Returns a buffer of exactly _bytes_ in size, whose contents are
+    // unspecified.  A retained buffer is only reused if it is not much larger
+    // than required, so that small acquisitions don't pin large buffers.
+    std::vector<char> acquire(const std::size_t bytes)
+    {
+        std::vector<char> buffer;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it(m_buffers.lower_bound(bytes));
+            if (it != m_buffers.end() && it->first <= bytes * 2)
+            {
+                buffer = std::move(it->second);
+                m_bytes -= it->first;
+                m_buffers.erase(it);
+            }
+        }
+
+        buffer.resize(bytes);
+        return buffer;
+    }
+
+    void release(std::vector<char>&& buffer)
+    {
+        const std::size_t capacity(buffer.capacity());
+        if (!capacity) return;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_bytes + capacity > m_maxBytes) return;
+
+        m_bytes += capacity;
+        m_buffers.emplace(capacity, std::move(buffer));
+    }
+
+    std::size_t bytes() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_bytes;
+    }
+
+private:
+    const std::size_t m_maxBytes;
+
+    mutable std::mutex m_mutex;
+    std::size_t m_bytes = 0;
+    std::multimap<std::size_t, std::vector<char>> m_buffers;
+
+    BufferPool(const BufferPool&);
+    BufferPool& operator=(const BufferPool&);
+};
+
+} // namespace entwine
+
@@ -10,6 +10,9 @@
 
 #include <entwine/util/executor.hpp>
 
+#include <algorithm>
+#include <cctype>
+#include <set>
 #include <sstream>
 
 #include <pdal/Dimension.hpp>
@@ -19,6 +22,8 @@
 #include <pdal/io/BufferReader.hpp>
 #include <pdal/io/LasReader.hpp>
 
+#include <entwine/io/laszip.hpp>
+#include <entwine/io/range-buffer.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/types/schema.hpp>
 #include <entwine/types/vector-point-table.hpp>
@@ -92,6 +97,62 @@ private:
     pdal::StreamPointTable& m_table;
 };
 
+#ifdef ENTWINE_HAVE_LASZIP
+// Reads the points of a LAS or LAZ file from a stream with LASzip.
+class LaszipStreamReader : public pdal::Reader, public pdal::Streamable
+{
+public:
+    LaszipStreamReader(LaszipReader& reader) : m_reader(reader) { }
+
+    std::string getName() const { return "readers.laszipstream"; }
+
+private:
+    virtual void addDimensions(pdal::PointLayoutPtr layout) override
+    {
+        using Id = pdal::Dimension::Id;
+
+        layout->registerDims({
+                Id::X, Id::Y, Id::Z,
+                Id::Intensity, Id::ReturnNumber, Id::NumberOfReturns,
+                Id::ScanDirectionFlag, Id::EdgeOfFlightLine,
+                Id::Classification, Id::ScanAngleRank, Id::UserData,
+                Id::PointSourceId });
+
+        if (m_reader.format() & 1) layout->registerDim(Id::GpsTime);
+        if (m_reader.format() & 2)
+        {
+            layout->registerDims({ Id::Red, Id::Green, Id::Blue });
+        }
+
+        for (const auto& e : m_reader.extraDims())
+        {
+            layout->registerOrAssignDim(e.name, e.type);
+        }
+    }
+
+    virtual void ready(pdal::PointTableRef table) override
+    {
+        const pdal::PointLayoutPtr layout(table.layout());
+        m_reader.select([layout](const std::string& name)
+        {
+            return layout->findDim(name);
+        });
+    }
+
+    virtual bool processOne(pdal::PointRef& pr) override
+    {
+        if (m_index == m_reader.points()) return false;
+
+        m_reader.read(pr);
+        ++m_index;
+        return true;
+    }
+
+    LaszipReader& m_reader;
+    uint64_t m_index = 0;
+};
+#endif
+
 std::unique_ptr<ScanInfo> Executor::preview(
         Json::Value pipeline,
         const bool trustHeaders) const
@@ -304,6 +365,105 @@ bool Executor::run(pdal::StreamPointTable& table, const Json::Value& pipeline)
     return true;
 }
 
+bool Executor::stream(
+        pdal::StreamPointTable& table,
+        const Json::Value& pipeline,
+        const arbiter::Arbiter& a)
+{
+#ifdef ENTWINE_HAVE_LASZIP
+    const Json::Value& readerJson(pipeline[0]);
+    const std::string path(readerJson["filename"].asString());
+
+    std::string ext(arbiter::Arbiter::getExtension(path));
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    if (ext != "las" && ext != "laz") return false;
+
+    // Only the options which we can apply ourselves may be set.
+    const std::set<std::string> supported {
+        "type", "filename", "override_srs", "default_srs", "spatialreference"
+    };
+
+    for (const std::string& key : readerJson.getMemberNames())
+    {
+        if (!supported.count(key)) return false;
+    }
+
+    if (readerJson.isMember("type") &&
+            readerJson["type"].asString() != "readers.las")
+    {
+        return false;
+    }
+
+    const auto size(a.tryGetSize(path));
+    if (!size) return false;
+
+    const arbiter::Endpoint ep(
+            a.getEndpoint(arbiter::util::getNonBasename(path)));
+    RangeBuffer buffer(ep, arbiter::util::getBasename(path), *size);
+    std::istream is(&buffer);
+
+    // If the header can't be read or isn't supported, then let PDAL try.
+    std::unique_ptr<LaszipReader> las;
+    try { las = makeUnique<LaszipReader>(is, path); }
+    catch (...) { return false; }
+
+    // Only WKT coordinate systems are read from the file, so if we have a
+    // GeoTIFF coordinate system which may be needed for reprojection, then
+    // we'll need PDAL to read it.
+    const Json::Value filters(slice(pipeline, 1));
+
+    // As in PDAL, "spatialreference" is an alias of "override_srs".
+    std::string srs;
+    if (readerJson.isMember("override_srs"))
+    {
+        srs = readerJson["override_srs"].asString();
+    }
+    else if (readerJson.isMember("spatialreference"))
+    {
+        srs = readerJson["spatialreference"].asString();
+    }
+    else if (!las->wkt().empty()) srs = las->wkt();
+    else if (readerJson.isMember("default_srs"))
+    {
+        srs = readerJson["default_srs"].asString();
+    }
+    else if (!filters.isNull()) return false;
+
+    LaszipStreamReader reader(*las);
+    if (!srs.empty()) reader.setSpatialReference(pdal::SpatialReference(srs));
+
+    auto lock(getLock());
+
+    pdal::PipelineManager pm;
+    pdal::Stage* last(&reader);
+
+    if (!filters.isNull())
+    {
+        std::istringstream filterStream(filters.toStyledString());
+        pm.readPipeline(filterStream);
+        last = pm.getStage();
+
+        pdal::Stage* first(last);
+        while (first->getInputs().size())
+        {
+            if (first->getInputs().size() > 1) return false;
+            first = first->getInputs().at(0);
+        }
+
+        if (!pm.pipelineStreamable()) return false;
+        first->setInput(reader);
+    }
+
+    last->prepare(table);
+    lock.unlock();
+
+    last->execute(table);
+    return true;
+#else
+    return false;
+#endif
+}
+
 std::unique_lock<std::mutex> Executor::getLock()
 {
     return std::unique_lock<std::mutex>(mutex());
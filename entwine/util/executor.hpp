@@ -31,6 +31,11 @@ namespace pdal
 namespace entwine
 {
 
+namespace arbiter
+{
+    class Arbiter;
+}
+
 class ScopedStage
 {
 public:
@@ -86,6 +91,14 @@ public:
 
     bool run(pdal::StreamPointTable& table, const Json::Value& pipeline);
 
+    // Run the pipeline with its input streamed through ranged reads rather
+    // than from a local copy.  Returns false, without reading any points, if
+    // this input or pipeline cannot be streamed.
+    bool stream(
+            pdal::StreamPointTable& table,
+            const Json::Value& pipeline,
+            const arbiter::Arbiter& arbiter);
+
     std::unique_ptr<ScanInfo> preview(
             Json::Value pipeline,
             bool trustHeaders = true) const;
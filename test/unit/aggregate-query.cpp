@@ -0,0 +1,81 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "ellipsoid.hpp"
+
+namespace
+{
+    const Verify v;
+}
+
+TEST(aggregateQuery, reduce)
+{
+    const std::string out(test::buildEllipsoid("ellipsoid"));
+
+    Reader r(out, "", std::make_shared<Cache>());
+
+    const Schema schema(DimList { { DimId::Intensity, DimType::Double } });
+    Json::Value j;
+    j["schema"] = schema.toJson();
+
+    auto all(r.read(j));
+    all->run();
+    ASSERT_EQ(all->points(), v.points());
+
+    const double* begin(reinterpret_cast<const double*>(all->data().data()));
+    const double* end(begin + all->points());
+    const double min(*std::min_element(begin, end));
+    const double max(*std::max_element(begin, end));
+    const double mean(std::accumulate(begin, end, 0.0) / all->points());
+
+    // Every node is entirely selected, so these are known without reading
+    // any points.
+    {
+        Reader fresh(out, "", std::make_shared<Cache>());
+
+        Json::Value q;
+        q["stats"].append("Intensity");
+
+        auto aggregate(fresh.aggregate(q));
+        aggregate->run();
+        EXPECT_EQ(fresh.cache().stats().misses, 0u);
+
+        const Json::Value s(aggregate->toJson()["stats"]["Intensity"]);
+        EXPECT_EQ(s["count"].asUInt64(), v.points());
+        EXPECT_EQ(s["min"].asDouble(), min);
+        EXPECT_EQ(s["max"].asDouble(), max);
+        EXPECT_NEAR(s["mean"].asDouble(), mean, 1e-6 * max);
+    }
+
+    // Histograms and grids require the points themselves.
+    Json::Value q;
+    q["stats"].append("Intensity");
+    q["histograms"]["Intensity"]["min"] = min;
+    q["histograms"]["Intensity"]["max"] = max;
+    q["histograms"]["Intensity"]["bins"] = 16;
+    q["grid"]["width"] = 8;
+    q["grid"]["height"] = 4;
+
+    auto aggregate(r.aggregate(q));
+    aggregate->run();
+    EXPECT_EQ(aggregate->points(), v.points());
+
+    const Json::Value s(aggregate->toJson()["stats"]["Intensity"]);
+    EXPECT_EQ(s["min"].asDouble(), min);
+    EXPECT_EQ(s["max"].asDouble(), max);
+    EXPECT_NEAR(s["mean"].asDouble(), mean, 1e-6 * max);
+
+    const auto& histogram(aggregate->histogram("Intensity"));
+    ASSERT_EQ(histogram.size(), 16u);
+    EXPECT_EQ(
+            std::accumulate(histogram.begin(), histogram.end(), uint64_t(0)),
+            v.points());
+
+    const auto& grid(aggregate->grid());
+    ASSERT_EQ(grid.size(), 32u);
+    EXPECT_EQ(
+            std::accumulate(grid.begin(), grid.end(), uint64_t(0)),
+            v.points());
+}
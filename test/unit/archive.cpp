@@ -0,0 +1,105 @@
+#include "gtest/gtest.h"
+
+#include "config.hpp"
+
+#include <string>
+#include <vector>
+
+#include <entwine/io/archive.hpp>
+#include <entwine/util/json.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const std::string root(test::dataPath() + "out/archive/");
+
+    std::vector<char> bytes(std::size_t n, char c)
+    {
+        return std::vector<char>(n, c);
+    }
+
+    Json::Value options()
+    {
+        Json::Value json;
+        json["step"] = 2;
+        json["bytes"] = 1024;
+        return json;
+    }
+}
+
+TEST(archive, rewrite)
+{
+    arbiter::fs::mkdirp(root + "rewrite/out");
+    arbiter::fs::mkdirp(root + "rewrite/tmp");
+
+    const arbiter::Arbiter a;
+    const arbiter::Endpoint out(a.getEndpoint(root + "rewrite/out"));
+    const arbiter::Endpoint tmp(a.getEndpoint(root + "rewrite/tmp"));
+
+    Json::Value json;
+
+    {
+        Archive archive(options());
+        archive.put(out, tmp, "1-0-0-0.bin", bytes(100, 'a'));
+        archive.put(out, tmp, "1-1-0-0.bin", bytes(10, 'b'));
+        archive.put(out, tmp, "1-0-0-0.bin", bytes(50, 'c'));
+
+        // Rewrites within the open segment are read back as rewritten.
+        EXPECT_EQ(archive.get(out, tmp, "1-0-0-0.bin"), bytes(50, 'c'));
+
+        archive.save(out, tmp);
+        json = archive.toJson();
+    }
+
+    // Only the latest data of each node is uploaded.
+    ASSERT_TRUE(out.tryGetSize("0-0-0-0-0.pack"));
+    EXPECT_EQ(*out.tryGetSize("0-0-0-0-0.pack"), 60u);
+
+    Archive archive(json);
+    EXPECT_EQ(archive.get(out, tmp, "1-0-0-0.bin"), bytes(50, 'c'));
+    EXPECT_EQ(archive.get(out, tmp, "1-1-0-0.bin"), bytes(10, 'b'));
+    EXPECT_EQ(archive.get(out, tmp, "1-1-0-0.bin", 2, 4), bytes(2, 'b'));
+}
+
+TEST(archive, nested)
+{
+    arbiter::fs::mkdirp(root + "nested/out");
+    arbiter::fs::mkdirp(root + "nested/tmp");
+
+    const arbiter::Arbiter a;
+    const arbiter::Endpoint out(a.getEndpoint(root + "nested/out"));
+    const arbiter::Endpoint tmp(a.getEndpoint(root + "nested/tmp"));
+
+    Json::Value json;
+
+    {
+        Archive archive(options());
+        archive.put(out, tmp, "4-3-2-1.bin", bytes(8, 'a'));
+        archive.save(out, tmp);
+        json = archive.toJson();
+    }
+
+    EXPECT_TRUE(json["saved"].asBool());
+
+    // Every index above a new one lists it, starting from the root.
+    const Json::Value rootIndex(parse(out.get("0-0-0-0.pack.json")));
+    ASSERT_EQ(rootIndex["children"].size(), 1u);
+    EXPECT_EQ(rootIndex["children"][0].asString(), "2-0-0-0");
+
+    const Json::Value index(parse(out.get("2-0-0-0.pack.json")));
+    ASSERT_EQ(index["children"].size(), 1u);
+    EXPECT_EQ(index["children"][0].asString(), "4-3-2-1");
+
+    // A continued build adds a sibling group to an existing index.
+    {
+        Archive archive(json);
+        archive.put(out, tmp, "5-0-0-0.bin", bytes(4, 'b'));
+        archive.save(out, tmp);
+    }
+
+    Archive archive(json);
+    EXPECT_EQ(archive.get(out, tmp, "4-3-2-1.bin"), bytes(8, 'a'));
+    EXPECT_EQ(archive.get(out, tmp, "5-0-0-0.bin"), bytes(4, 'b'));
+    EXPECT_EQ(parse(out.get("2-0-0-0.pack.json"))["children"].size(), 2u);
+}
@@ -2,6 +2,11 @@
 #include "config.hpp"
 #include "verify.hpp"
 
+#include <set>
+
+#include <sys/stat.h>
+#include <utime.h>
+
 #include <entwine/builder/builder.hpp>
 #include <entwine/builder/merger.hpp>
 #include <entwine/builder/scan.hpp>
@@ -13,6 +18,24 @@ namespace
     const arbiter::Arbiter a;
     const Verify v;
 
+    // Backdate every file under _dir_, so that files rewritten afterward can
+    // be told apart by their modification times.
+    void backdate(const std::string& dir)
+    {
+        for (const std::string& path : a.resolve(dir + "**"))
+        {
+            const utimbuf t { 0, 0 };
+            ASSERT_EQ(utime(path.c_str(), &t), 0) << path;
+        }
+    }
+
+    bool rewritten(const std::string& path)
+    {
+        struct stat s;
+        EXPECT_EQ(stat(path.c_str(), &s), 0) << path;
+        return s.st_mtime != 0;
+    }
+
     void checkSources(std::string outPath)
     {
         const auto list(parse(a.get(outPath + "ept-sources/list.json")));
@@ -142,6 +165,121 @@ TEST(build, continued)
     checkSources(outPath);
 }
 
+TEST(build, appended)
+{
+    const std::string outPath(test::dataPath() + "out/ellipsoid/");
+    const std::string inPath(test::dataPath() + "ellipsoid-multi/");
+
+    {
+        Config c;
+        c["input"].append(inPath + "ned.laz");
+        c["input"].append(inPath + "neu.laz");
+        c["input"].append(inPath + "nwd.laz");
+        c["input"].append(inPath + "nwu.laz");
+        c["output"] = outPath;
+        c["force"] = true;
+        c["bounds"] = v.bounds().toJson();
+        c["ticks"] = static_cast<Json::UInt64>(v.ticks());
+        c["hierarchyStep"] = static_cast<Json::UInt64>(v.hierarchyStep());
+
+        Builder(c).go();
+    }
+
+    backdate(outPath);
+
+    {
+        // Only the new files are scanned and inserted, and the detailed source
+        // metadata for the existing files must be preserved.
+        Config c;
+        c["input"] = inPath;
+        c["output"] = outPath;
+
+        Builder(c).go();
+    }
+
+    const auto info(parse(a.get(outPath + "ept.json")));
+    EXPECT_EQ(info["points"].asUInt64(), v.points());
+
+    checkSources(outPath);
+
+    // The new files lie in the southern half of the ellipsoid, so data nodes
+    // and hierarchy pages covering only its northern half are untouched.
+    EXPECT_TRUE(rewritten(outPath + "ept-sources/list.json"));
+
+    for (const std::string dir : { "ept-hierarchy/", "ept-data/" })
+    {
+        std::size_t kept(0), written(0);
+        for (const std::string& path : a.resolve(outPath + dir + "*"))
+        {
+            ++(rewritten(path) ? written : kept);
+        }
+
+        EXPECT_GT(written, 0u) << dir;
+        EXPECT_GT(kept, 0u) << dir;
+    }
+}
+
+TEST(build, appendedDuplicateName)
+{
+    // A file sharing a basename with one already in the build changes the IDs
+    // of all detailed source metadata, which must then be rewritten in full.
+    const std::string outPath(test::dataPath() + "out/ellipsoid/");
+    const std::string freshPath(test::dataPath() + "out/ellipsoid-fresh/");
+    const std::string inPath(test::dataPath() + "ellipsoid-multi/");
+    const std::string dupe(test::dataPath() + "out/duplicate/ned.laz");
+
+    a.copyFile(inPath + "sed.laz", dupe);
+
+    Json::Value inputs;
+    inputs.append(inPath + "ned.laz");
+    inputs.append(inPath + "neu.laz");
+
+    auto build([&](const std::string out, const Json::Value& input)
+    {
+        Config c;
+        c["input"] = input;
+        c["output"] = out;
+        c["force"] = true;
+        c["bounds"] = v.bounds().toJson();
+        c["ticks"] = static_cast<Json::UInt64>(v.ticks());
+        c["hierarchyStep"] = static_cast<Json::UInt64>(v.hierarchyStep());
+        Builder(c).go();
+    });
+
+    build(outPath, inputs);
+
+    inputs.append(dupe);
+
+    {
+        Config c;
+        c["input"] = inputs;
+        c["output"] = outPath;
+        EXPECT_NO_THROW(Builder(c).go());
+    }
+
+    build(freshPath, inputs);
+
+    const auto info(parse(a.get(outPath + "ept.json")));
+    const auto fresh(parse(a.get(freshPath + "ept.json")));
+    EXPECT_EQ(info["points"], fresh["points"]);
+
+    const auto list(parse(a.get(outPath + "ept-sources/list.json")));
+    ASSERT_EQ(list.size(), 3u);
+
+    std::set<std::string> ids;
+    for (const Json::Value& entry : list)
+    {
+        const std::string id(entry["id"].asString());
+        EXPECT_TRUE(ids.insert(id).second) << id;
+
+        const std::string url(entry["url"].asString());
+        const auto full(parse(a.get(outPath + "ept-sources/" + url)));
+        ASSERT_TRUE(full.isMember(id));
+        EXPECT_TRUE(full[id]["metadata"].isObject());
+        EXPECT_GT(full[id]["points"].asUInt64(), 0u);
+    }
+}
+
 TEST(build, fromScan)
 {
     const std::string scanPath(test::dataPath() + "out/prebuild-scan/");
@@ -0,0 +1,106 @@
+#include "gtest/gtest.h"
+
+#include "ellipsoid.hpp"
+
+namespace
+{
+    const Verify v;
+}
+
+TEST(cache, chunks)
+{
+    const std::string out(test::buildEllipsoid("ellipsoid"));
+
+    Reader r(out, "", std::make_shared<Cache>());
+
+    auto first(r.count(Json::Value()));
+    first->run();
+    EXPECT_EQ(first->points(), v.points());
+
+    const Cache::Stats before(r.cache().stats());
+    EXPECT_GT(before.misses, 0u);
+    EXPECT_EQ(before.evictions, 0u);
+
+    // Everything is cached now, so nothing is loaded again.
+    auto second(r.count(Json::Value()));
+    second->run();
+    EXPECT_EQ(second->points(), v.points());
+
+    const Cache::Stats after(r.cache().stats());
+    EXPECT_EQ(after.misses, before.misses);
+    EXPECT_EQ(after.hits + after.waits, before.hits + before.waits +
+            before.misses);
+
+    // With a budget too small to hold anything, chunks are evicted as soon as
+    // they are loaded, but results are unaffected.
+    r.cache().setMaxBytes(1);
+    EXPECT_LE(r.cache().size(), 1u);
+
+    auto third(r.count(Json::Value()));
+    third->run();
+    EXPECT_EQ(third->points(), v.points());
+    EXPECT_GT(r.cache().stats().evictions, 0u);
+    EXPECT_EQ(r.cache().size(), 0u);
+}
+
+TEST(cache, results)
+{
+    const std::string out(test::buildEllipsoid("ellipsoid"));
+
+    Reader r(out, "", std::make_shared<Cache>());
+    auto results(std::make_shared<ResultCache>());
+    r.setResultCache(results);
+
+    const Schema schema(DimList { DimId::X, DimId::Y, DimId::Z });
+
+    // Equivalent queries share a key.
+    Json::Value a;
+    a["schema"] = schema.toJson();
+    a["filter"]["Intensity"] = 5;
+
+    Json::Value b(a);
+    b["filter"]["Intensity"] = Json::Value();
+    b["filter"]["Intensity"]["$eq"] = 5.0;
+    b["prefetch"] = 4;
+    EXPECT_EQ(
+            ResultCache::key(r.dataset(), a),
+            ResultCache::key(r.dataset(), b));
+
+    Json::Value q;
+    q["schema"] = schema.toJson();
+    q["depthEnd"] = 4;
+
+    auto first(r.read(q));
+    first->run();
+    const auto misses(r.cache().stats().misses);
+    EXPECT_GT(misses, 0u);
+
+    // The second is answered without reading any chunks.
+    auto second(r.read(q));
+    second->run();
+    EXPECT_EQ(r.cache().stats().misses, misses);
+    EXPECT_EQ(results->stats().hits, 1u);
+    EXPECT_EQ(second->points(), first->points());
+    EXPECT_EQ(second->data(), first->data());
+
+    // Which also applies when streaming.
+    std::vector<char> streamed;
+    auto third(r.read(q));
+    third->run([&streamed](const char* data, std::size_t size, std::size_t)
+    {
+        streamed.insert(streamed.end(), data, data + size);
+    }, 100);
+    EXPECT_EQ(results->stats().hits, 2u);
+    EXPECT_EQ(streamed, first->data());
+
+    // A cached result is found without traversing the hierarchy beyond the
+    // root page fetched on construction.
+    Reader fresh(out);
+    fresh.setResultCache(results);
+
+    auto fourth(fresh.read(q));
+    fourth->run();
+    EXPECT_EQ(results->stats().hits, 3u);
+    EXPECT_EQ(fresh.hierarchy().fetches(), 1u);
+    EXPECT_EQ(fourth->data(), first->data());
+}
@@ -0,0 +1,86 @@
+#include "gtest/gtest.h"
+
+#include "config.hpp"
+#include "verify.hpp"
+
+#include <entwine/builder/builder.hpp>
+#include <entwine/reader/reader.hpp>
+#include <entwine/util/json.hpp>
+
+namespace
+{
+    const Verify v;
+
+    std::vector<char> readAll(const std::string& out)
+    {
+        Reader r(out, "", std::make_shared<Cache>());
+
+        Json::Value j;
+        j["schema"] = Schema(DimList { DimId::X, DimId::Y, DimId::Z }).toJson();
+
+        auto q(r.read(j));
+        q->run();
+        return q->data();
+    }
+
+    // Chunks are sized by their hierarchy counts, but must be read correctly
+    // even if those are wrong.
+    void checkWrongCounts(const std::string& type)
+    {
+        const std::string out(
+                test::dataPath() + "out/ellipsoid/ellipsoid-counts-" + type);
+
+        {
+            Config c;
+            c["input"] = test::dataPath() + "ellipsoid.laz";
+            c["output"] = out;
+            c["force"] = true;
+            c["dataType"] = type;
+            c["ticks"] = static_cast<Json::UInt64>(v.ticks());
+
+            Builder b(c);
+            b.go();
+        }
+
+        const std::vector<char> expected(readAll(out));
+        ASSERT_EQ(expected.size(), v.points() * 3 * sizeof(double));
+
+        // Alternately understate and overstate the count of each node.
+        const arbiter::Arbiter a;
+        const arbiter::Endpoint ep(a.getEndpoint(out + "/ept-hierarchy"));
+        Json::Value hierarchy(parse(ep.get("0-0-0-0.json")));
+
+        bool under(true);
+        for (const std::string& key : hierarchy.getMemberNames())
+        {
+            Json::Value& count(hierarchy[key]);
+            const int64_t n(count.asInt64());
+            if (n <= 0) continue;
+
+            count = static_cast<Json::Int64>(
+                    under ? std::max<int64_t>(n / 3, 1) : n * 2);
+            under = !under;
+        }
+
+        ep.put("0-0-0-0.json", hierarchy.toStyledString());
+
+        EXPECT_EQ(readAll(out), expected);
+    }
+}
+
+TEST(chunkReader, wrongCountsBinary)
+{
+    checkWrongCounts("binary");
+}
+
+TEST(chunkReader, wrongCountsLaszip)
+{
+    checkWrongCounts("laszip");
+}
+
+#ifdef ENTWINE_HAVE_ZSTD
+TEST(chunkReader, wrongCountsZstandard)
+{
+    checkWrongCounts("zstandard");
+}
+#endif
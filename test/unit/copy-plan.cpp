@@ -0,0 +1,124 @@
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <vector>
+
+#include <entwine/types/copy-plan.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    template<typename T>
+    T get(const char* pos)
+    {
+        T v;
+        std::memcpy(&v, pos, sizeof(T));
+        return v;
+    }
+
+    template<typename T>
+    void set(char* pos, T v)
+    {
+        std::memcpy(pos, &v, sizeof(T));
+    }
+
+    const Schema absolute(DimList {
+            DimInfo(DimId::X, DimType::Double),
+            DimInfo(DimId::Y, DimType::Double),
+            DimInfo(DimId::Z, DimType::Double),
+            DimInfo(DimId::Intensity, DimType::Unsigned16),
+            DimInfo(DimId::Classification, DimType::Unsigned8)
+    });
+
+    const Schema scaled(DimList {
+            DimInfo(DimId::X, DimType::Signed32, 0.25, 100),
+            DimInfo(DimId::Y, DimType::Signed32, 0.5, 200),
+            DimInfo(DimId::Z, DimType::Signed32, 0.125, 300),
+            DimInfo(DimId::Intensity, DimType::Unsigned16),
+            DimInfo(DimId::Classification, DimType::Unsigned8),
+            DimInfo(DimId::UserData, DimType::Unsigned8)
+    });
+}
+
+TEST(copyPlan, scale)
+{
+    const uint64_t np(1000);
+
+    std::vector<char> src(np * absolute.pointSize());
+    for (uint64_t i(0); i < np; ++i)
+    {
+        char* pos(src.data() + i * absolute.pointSize());
+        set<double>(pos, 100 + i * 0.25);
+        set<double>(pos + 8, 200 - i * 0.5);
+        set<double>(pos + 16, 300 + i);
+        set<uint16_t>(pos + 24, i);
+        set<uint8_t>(pos + 26, i % 32);
+    }
+
+    const CopyPlan pack(absolute, scaled);
+    ASSERT_EQ(pack.srcPointSize(), absolute.pointSize());
+    ASSERT_EQ(pack.dstPointSize(), scaled.pointSize());
+
+    std::vector<char> packed(np * scaled.pointSize(), 1);
+    pack.apply(src.data(), packed.data(), np);
+
+    for (uint64_t i(0); i < np; ++i)
+    {
+        const char* pos(packed.data() + i * scaled.pointSize());
+        ASSERT_EQ(get<int32_t>(pos), static_cast<int32_t>(i));
+        ASSERT_EQ(get<int32_t>(pos + 4), -static_cast<int32_t>(i));
+        ASSERT_EQ(get<int32_t>(pos + 8), static_cast<int32_t>(i * 8));
+        ASSERT_EQ(get<uint16_t>(pos + 12), i);
+        ASSERT_EQ(get<uint8_t>(pos + 14), i % 32);
+        ASSERT_EQ(get<uint8_t>(pos + 15), 0);
+    }
+
+    const CopyPlan unpack(scaled, absolute);
+    std::vector<char> unpacked(src.size());
+    unpack.apply(packed.data(), unpacked.data(), np);
+
+    ASSERT_EQ(unpacked, src);
+}
+
+TEST(copyPlan, referenced)
+{
+    const Schema subset(DimList {
+            DimInfo(DimId::Classification, DimType::Double),
+            DimInfo(DimId::X, DimType::Double)
+    });
+
+    std::vector<char> a(absolute.pointSize(), 0);
+    std::vector<char> b(absolute.pointSize(), 0);
+    set<double>(a.data(), 1.5);
+    set<uint8_t>(a.data() + 26, 2);
+    set<double>(b.data(), 3.5);
+    set<uint8_t>(b.data() + 26, 4);
+
+    const std::vector<const char*> refs { b.data(), a.data() };
+
+    const CopyPlan plan(absolute, subset);
+    std::vector<char> dst(2 * subset.pointSize());
+    plan.apply(refs.data(), dst.data(), refs.size());
+
+    EXPECT_EQ(get<double>(dst.data()), 4);
+    EXPECT_EQ(get<double>(dst.data() + 8), 3.5);
+    EXPECT_EQ(get<double>(dst.data() + 16), 2);
+    EXPECT_EQ(get<double>(dst.data() + 24), 1.5);
+}
+
+TEST(copyPlan, range)
+{
+    const Schema narrow(DimList {
+            DimInfo(DimId::X, DimType::Signed8),
+            DimInfo(DimId::Y, DimType::Signed8),
+            DimInfo(DimId::Z, DimType::Signed8)
+    });
+
+    std::vector<char> src(absolute.pointSize(), 0);
+    set<double>(src.data(), 1000);
+
+    const CopyPlan plan(absolute, narrow);
+    std::vector<char> dst(narrow.pointSize());
+    EXPECT_THROW(plan.apply(src.data(), dst.data(), 1), std::runtime_error);
+}
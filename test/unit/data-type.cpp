@@ -0,0 +1,127 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+
+#include "ellipsoid.hpp"
+
+namespace
+{
+    const Verify v;
+
+    // Every point of the binary build, against which those of the other data
+    // types are compared.
+    const std::vector<std::string>& baseline()
+    {
+        static const std::vector<std::string> points(
+                test::readSorted(Reader(test::buildEllipsoid("ellipsoid"))));
+        return points;
+    }
+
+    void expectBaseline(const std::vector<std::string>& points)
+    {
+        ASSERT_EQ(baseline().size(), v.points());
+        ASSERT_EQ(points.size(), baseline().size());
+        EXPECT_TRUE(points == baseline());
+    }
+}
+
+#ifdef ENTWINE_HAVE_ZSTD
+TEST(dataType, zstandard)
+{
+    Json::Value options;
+    options["dataType"] = "zstandard";
+    options["dataOptions"]["level"] = 5;
+    options["dataOptions"]["dictionary"] = true;
+    const std::string out(test::buildEllipsoid("ellipsoid-zstd", options));
+
+    Reader r(out);
+    EXPECT_EQ(r.metadata().dataIo().type(), "zstandard");
+
+    expectBaseline(test::readSorted(r));
+}
+#endif
+
+TEST(dataType, columnar)
+{
+    Json::Value options;
+    options["dataType"] = "columnar";
+    const std::string out(test::buildEllipsoid("ellipsoid-col", options));
+
+    Reader r(out);
+    const Metadata& m(r.metadata());
+    EXPECT_EQ(m.dataIo().type(), "columnar");
+
+    // Read only XYZ first, so the remaining columns must be filled in later
+    // for the cached chunks.
+    const Schema xyz(DimList { DimId::X, DimId::Y, DimId::Z });
+
+    Json::Value j;
+    j["schema"] = xyz.toJson();
+
+    auto q(r.read(j));
+    q->run();
+    ASSERT_EQ(q->data().size(), v.points() * xyz.pointSize());
+
+    const Schema& schema(m.schema());
+    j["schema"] = schema.toJson();
+
+    auto full(r.read(j));
+    full->run();
+    ASSERT_EQ(full->data().size(), v.points() * schema.pointSize());
+
+    for (std::size_t i(0); i < v.points(); ++i)
+    {
+        const char* a(q->data().data() + i * xyz.pointSize());
+        const char* b(full->data().data() + i * schema.pointSize());
+        ASSERT_TRUE(std::equal(a, a + xyz.pointSize(), b));
+    }
+
+    expectBaseline(test::sorted(full->data(), schema));
+}
+
+TEST(dataType, spatial)
+{
+    Json::Value options;
+    options["dataType"] = "spatial";
+    options["scale"] = 0.01;
+    const std::string out(test::buildEllipsoid("ellipsoid-spatial", options));
+
+    Reader r(out);
+    const Metadata& m(r.metadata());
+    EXPECT_EQ(m.dataIo().type(), "spatial");
+
+    uint64_t np(0);
+    for (std::size_t i(0); i < 8; ++i)
+    {
+        Json::Value q;
+        q["bounds"] = m.boundsCubic().get(toDir(i)).toJson();
+
+        auto countQuery = r.count(q);
+        countQuery->run();
+        np += countQuery->points();
+    }
+
+    EXPECT_EQ(np, v.points());
+
+    // Points are reordered within each node, but are otherwise unchanged.
+    expectBaseline(test::readSorted(r));
+}
+
+TEST(dataType, packed)
+{
+    Json::Value options;
+    options["dataType"] = "binary";
+    options["dataOptions"]["pack"]["step"] = 2;
+    options["dataOptions"]["pack"]["bytes"] = 65536;
+    const std::string out(test::buildEllipsoid("ellipsoid-packed", options));
+
+    const arbiter::Arbiter a;
+    const arbiter::Endpoint ep(a.getEndpoint(out));
+    EXPECT_EQ(ep.tryGetSize("ept-data/0-0-0-0.bin"), nullptr);
+    EXPECT_NE(ep.tryGetSize("ept-data/0-0-0-0.pack.json"), nullptr);
+
+    Reader r(out);
+    EXPECT_TRUE(r.metadata().dataIo().packed());
+
+    expectBaseline(test::readSorted(r));
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "verify.hpp"
+
+#include <entwine/builder/builder.hpp>
+#include <entwine/reader/reader.hpp>
+
+namespace test
+{
+
+// Build the ellipsoid to out/ellipsoid/_name_, with any members of _options_
+// overriding its configuration, and return the output path.
+inline std::string buildEllipsoid(
+        const std::string& name,
+        const Json::Value& options = Json::Value())
+{
+    const Verify v;
+    const std::string out(dataPath() + "out/ellipsoid/" + name);
+
+    Json::Value json;
+    json["input"] = dataPath() + "ellipsoid.laz";
+    json["output"] = out;
+    json["force"] = true;
+    json["hierarchyStep"] = static_cast<Json::UInt64>(v.hierarchyStep());
+    json["ticks"] = static_cast<Json::UInt64>(v.ticks());
+
+    for (const std::string& key : options.getMemberNames())
+    {
+        json[key] = options[key];
+    }
+
+    Builder b{Config(json)};
+    b.go();
+
+    return out;
+}
+
+// The points of _data_, laid out according to _schema_, sorted so that the
+// results of different builds may be compared regardless of the order in
+// which their points were inserted.
+inline std::vector<std::string> sorted(
+        const std::vector<char>& data,
+        const Schema& schema)
+{
+    std::vector<std::string> points;
+    const std::size_t pointSize(schema.pointSize());
+    for (std::size_t i(0); i + pointSize <= data.size(); i += pointSize)
+    {
+        points.emplace_back(data.data() + i, pointSize);
+    }
+
+    std::sort(points.begin(), points.end());
+    return points;
+}
+
+// Read every point of _r_ in the absolute schema of its dataset, sorted.
+inline std::vector<std::string> readSorted(const Reader& r)
+{
+    const Schema& schema(r.metadata().schema());
+
+    Json::Value j;
+    j["schema"] = schema.toJson();
+
+    auto q(r.read(j));
+    q->run();
+    return sorted(q->data(), schema);
+}
+
+} // namespace test
+
@@ -0,0 +1,126 @@
+#include "gtest/gtest.h"
+
+#ifdef ENTWINE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "ellipsoid.hpp"
+
+namespace
+{
+    const Verify v;
+}
+
+TEST(encoder, columnar)
+{
+    const std::string out(test::buildEllipsoid("ellipsoid"));
+
+    Reader r(out, "", std::make_shared<Cache>());
+    const Schema schema(DimList { DimId::X, DimId::Y, DimId::Z });
+
+    Json::Value j;
+    j["schema"] = schema.toJson();
+    j["bounds"] = r.metadata().boundsConforming().toJson();
+
+    auto binary(r.read(j));
+    binary->run();
+    ASSERT_EQ(binary->points(), v.points());
+
+    // Each node is encoded column by column, which transposed back matches
+    // the binary output.
+    j["encoding"] = "columnar";
+
+    const std::size_t pointSize(schema.pointSize());
+    std::vector<char> rows;
+    uint64_t np(0);
+
+    auto columnar(r.read(j));
+    columnar->run([&](const char* data, std::size_t size, std::size_t n)
+    {
+        EXPECT_EQ(size, n * pointSize);
+        const std::size_t begin(rows.size());
+        rows.resize(begin + n * pointSize);
+
+        const char* pos(data);
+        std::size_t offset(0);
+        for (const DimInfo& d : schema.dims())
+        {
+            for (std::size_t i(0); i < n; ++i)
+            {
+                char* dst(rows.data() + begin + i * pointSize + offset);
+                std::copy(pos, pos + d.size(), dst);
+                pos += d.size();
+            }
+            offset += d.size();
+        }
+
+        np += n;
+    });
+
+    EXPECT_EQ(np, binary->points());
+    EXPECT_EQ(rows, binary->data());
+}
+
+#ifdef ENTWINE_HAVE_ZSTD
+TEST(encoder, zstandard)
+{
+    const std::string out(test::buildEllipsoid("ellipsoid"));
+
+    Reader r(out, "", std::make_shared<Cache>());
+    const Schema schema(DimList { DimId::X, DimId::Y, DimId::Z });
+    const std::size_t pointSize(schema.pointSize());
+
+    Json::Value j;
+    j["schema"] = schema.toJson();
+
+    auto binary(r.read(j));
+    binary->run();
+    ASSERT_EQ(binary->points(), v.points());
+
+    // Each node is a single frame, which decompresses to its binary output.
+    j["encoding"] = "zstandard";
+
+    std::vector<char> rows;
+    auto streamed(r.read(j));
+    streamed->run([&](const char* data, std::size_t size, std::size_t n)
+    {
+        const std::size_t begin(rows.size());
+        rows.resize(begin + n * pointSize);
+
+        const std::size_t result(
+                ZSTD_decompress(
+                    rows.data() + begin,
+                    n * pointSize,
+                    data,
+                    size));
+        ASSERT_FALSE(ZSTD_isError(result));
+        EXPECT_EQ(result, n * pointSize);
+    });
+
+    EXPECT_EQ(rows, binary->data());
+
+    // Frames may be concatenated, so the whole result is equivalent.
+    auto whole(r.read(j));
+    whole->run();
+
+    std::vector<char> all(binary->data().size());
+    EXPECT_EQ(
+            ZSTD_decompress(
+                all.data(),
+                all.size(),
+                whole->data().data(),
+                whole->data().size()),
+            all.size());
+    EXPECT_EQ(all, binary->data());
+}
+#endif
+
+TEST(encoder, invalid)
+{
+    const std::string out(test::buildEllipsoid("ellipsoid"));
+    Reader r(out);
+
+    Json::Value bad;
+    bad["encoding"] = "unknown";
+    EXPECT_THROW(r.read(bad), std::runtime_error);
+}
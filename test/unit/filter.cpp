@@ -0,0 +1,200 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <functional>
+
+#include "ellipsoid.hpp"
+
+#include <entwine/types/files.hpp>
+
+namespace
+{
+    const Verify v;
+}
+
+TEST(filter, logic)
+{
+    const std::string out(test::buildEllipsoid("ellipsoid"));
+
+    Reader r(out);
+
+    const Schema schema(DimList {
+        { DimId::X, DimType::Double },
+        { DimId::Intensity, DimType::Double }
+    });
+
+    Json::Value j;
+    j["schema"] = schema.toJson();
+
+    auto all(r.read(j));
+    all->run();
+    ASSERT_EQ(all->points(), v.points());
+
+    std::vector<double> xs, intensities;
+    for (uint64_t i(0); i < all->points(); ++i)
+    {
+        const double* p(
+                reinterpret_cast<const double*>(
+                    all->data().data() + i * schema.pointSize()));
+        xs.push_back(p[0]);
+        intensities.push_back(p[1]);
+    }
+
+    auto mid([](std::vector<double> v)
+    {
+        std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+        return v[v.size() / 2];
+    });
+
+    const double x(mid(xs));
+    const double intensity(mid(intensities));
+
+    auto count([&r](const Json::Value& filter)
+    {
+        Json::Value q;
+        q["filter"] = filter;
+
+        auto query(r.count(q));
+        query->run();
+        return query->points();
+    });
+
+    auto expect([&](std::function<bool(double, double)> f)
+    {
+        uint64_t n(0);
+        for (std::size_t i(0); i < xs.size(); ++i)
+        {
+            if (f(xs[i], intensities[i])) ++n;
+        }
+        return n;
+    });
+
+    Json::Value filter;
+    filter["Intensity"]["$gte"] = intensity;
+    EXPECT_EQ(count(filter), expect([&](double, double in)
+    {
+        return in >= intensity;
+    }));
+
+    filter = Json::Value();
+    filter["$or"][0]["Intensity"]["$lt"] = intensity;
+    filter["$or"][1]["X"]["$gte"] = x;
+    EXPECT_EQ(count(filter), expect([&](double px, double in)
+    {
+        return in < intensity || px >= x;
+    }));
+
+    filter = Json::Value();
+    filter["$nor"][0]["Intensity"]["$in"].append(intensity);
+    filter["$nor"][1]["X"]["$lt"] = x;
+    EXPECT_EQ(count(filter), expect([&](double px, double in)
+    {
+        return !(in == intensity || px < x);
+    }));
+}
+
+TEST(filter, contained)
+{
+    const std::string out(test::buildEllipsoid("ellipsoid"));
+
+    Reader r(out, "", std::make_shared<Cache>());
+    const Metadata& m(r.metadata());
+
+    // Every node is entirely selected, so nothing needs to be read.
+    auto all(r.count(Json::Value()));
+    all->run();
+    EXPECT_EQ(all->points(), v.points());
+    EXPECT_EQ(r.cache().stats().misses, 0u);
+
+    // A spatial filter which every node passes is equivalent.
+    Json::Value q;
+    q["filter"]["Z"]["$gte"] = m.boundsCubic().min().z;
+
+    auto filtered(r.count(q));
+    filtered->run();
+    EXPECT_EQ(filtered->points(), v.points());
+    EXPECT_EQ(r.cache().stats().misses, 0u);
+
+    // Whereas one which no node passes entirely must be evaluated.
+    q["filter"]["Z"]["$gte"] = m.boundsCubic().mid().z;
+
+    auto half(r.count(q));
+    half->run();
+    EXPECT_LT(half->points(), v.points());
+    EXPECT_GT(r.cache().stats().misses, 0u);
+}
+
+TEST(filter, stats)
+{
+    const std::string out(test::buildEllipsoid("ellipsoid"));
+
+    Reader r(out, "", std::make_shared<Cache>());
+
+    const auto root(r.hierarchy().stats(Dxyz()));
+    ASSERT_TRUE(root);
+    const NodeStats::Dim* intensity(root->find("Intensity"));
+    ASSERT_TRUE(intensity);
+    EXPECT_LE(intensity->min, intensity->max);
+
+    // No node has a point with an intensity this high, so none are read.
+    Json::Value q;
+    q["filter"]["Intensity"]["$gt"] = 65535;
+
+    auto none(r.count(q));
+    none->run();
+    EXPECT_EQ(none->points(), 0u);
+    EXPECT_EQ(r.cache().stats().misses, 0u);
+
+    // And every point has an intensity at least this low.
+    q["filter"]["Intensity"] = Json::Value();
+    q["filter"]["Intensity"]["$lte"] = 65535;
+
+    auto all(r.count(q));
+    all->run();
+    EXPECT_EQ(all->points(), v.points());
+    EXPECT_EQ(r.cache().stats().misses, 0u);
+}
+
+TEST(filter, origins)
+{
+    Json::Value options;
+    options["input"] = test::dataPath() + "ellipsoid-multi/";
+    const std::string out(test::buildEllipsoid("ellipsoid-multi", options));
+
+    // Reading every point requires every node.
+    uint64_t nodes(0);
+    std::size_t origins(0);
+    {
+        Reader r(out, "", std::make_shared<Cache>());
+        origins = r.metadata().files().size();
+
+        Json::Value j;
+        j["schema"] = Schema(DimList { DimId::X, DimId::Y, DimId::Z }).toJson();
+
+        auto all(r.read(j));
+        all->run();
+        EXPECT_EQ(all->points(), v.points());
+        nodes = r.cache().stats().misses;
+    }
+
+    ASSERT_GT(origins, 1u);
+
+    // Each node records the origins of its points, so a query for a single
+    // origin reads only the nodes which contain it along with others.
+    uint64_t np(0);
+    for (std::size_t i(0); i < origins; ++i)
+    {
+        Reader r(out, "", std::make_shared<Cache>());
+
+        Json::Value q;
+        q["filter"]["OriginId"] = static_cast<Json::UInt64>(i);
+
+        auto query(r.count(q));
+        query->run();
+        np += query->points();
+
+        EXPECT_LT(r.cache().stats().misses, nodes);
+    }
+
+    EXPECT_EQ(np, v.points());
+}
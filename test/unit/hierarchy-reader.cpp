@@ -0,0 +1,107 @@
+#include "gtest/gtest.h"
+
+#include <functional>
+
+#include "ellipsoid.hpp"
+
+#include <entwine/util/json.hpp>
+
+namespace
+{
+    const Verify v;
+}
+
+TEST(hierarchyReader, pages)
+{
+    const std::string out(test::buildEllipsoid("ellipsoid"));
+
+    Reader r(out);
+    const Metadata& m(r.metadata());
+
+    // Only the root page is fetched until a query descends further.
+    EXPECT_EQ(r.hierarchy().fetches(), 1u);
+
+    auto q(r.count(Json::Value()));
+    q->run();
+    EXPECT_EQ(q->points(), v.points());
+    EXPECT_GT(r.hierarchy().fetches(), 1u);
+
+    // With a budget which holds only a single page beyond the root, pages
+    // are refetched as needed but the counts are unaffected.
+    const arbiter::Arbiter a;
+    const HierarchyReader tiny(a.getEndpoint(out), m.nodeStats(), 1);
+
+    uint64_t np(0);
+    std::function<void(const ChunkKey&)> walk([&](const ChunkKey& c)
+    {
+        const uint64_t n(tiny.count(c.get()));
+        EXPECT_EQ(n, r.hierarchy().count(c.get()));
+        if (!n) return;
+
+        np += n;
+        for (std::size_t i(0); i < dirEnd(); ++i) walk(c.getStep(toDir(i)));
+    });
+    walk(ChunkKey(m));
+
+    EXPECT_EQ(np, v.points());
+    EXPECT_LE(tiny.pages(), 2u);
+
+    // Statistics are fetched alongside each page only if our metadata says
+    // they were written, which was not the case for older indexes.
+    const ChunkKey root(m);
+    EXPECT_TRUE(m.nodeStats());
+    EXPECT_TRUE(r.hierarchy().stats(root.get()));
+
+    const arbiter::Endpoint ep(a.getEndpoint(out));
+    Json::Value build(parse(ep.get("ept-build.json")));
+    build["nodeStats"] = false;
+    ep.put("ept-build.json", build.toStyledString());
+    ASSERT_TRUE(arbiter::fs::remove(
+                out + "/ept-hierarchy/" + root.toString() + ".stats.json"));
+
+    Reader old(out);
+    EXPECT_FALSE(old.metadata().nodeStats());
+    EXPECT_FALSE(old.hierarchy().stats(root.get()));
+
+    auto c(old.count(Json::Value()));
+    c->run();
+    EXPECT_EQ(c->points(), v.points());
+}
+
+TEST(hierarchyReader, prefetch)
+{
+    const std::string out(test::buildEllipsoid("ellipsoid"));
+
+    Reader r(out);
+    const Metadata& m(r.metadata());
+
+    std::vector<Dxyz> keys;
+    std::function<void(const ChunkKey&)> walk([&](const ChunkKey& c)
+    {
+        if (!r.hierarchy().count(c.get())) return;
+
+        keys.push_back(c.get());
+        for (std::size_t i(0); i < dirEnd(); ++i) walk(c.getStep(toDir(i)));
+    });
+    walk(ChunkKey(m));
+
+    const uint64_t total(r.hierarchy().fetches());
+    ASSERT_GT(total, 2u);
+
+    // Every page, including nested ones, is fetched up front, after which
+    // counting fetches nothing more.
+    const arbiter::Arbiter a;
+    const HierarchyReader wide(a.getEndpoint(out), m.nodeStats());
+    wide.prefetch(keys);
+    EXPECT_EQ(wide.fetches(), total);
+
+    for (const Dxyz& k : keys) EXPECT_EQ(wide.count(k), r.hierarchy().count(k));
+    EXPECT_EQ(wide.fetches(), total);
+
+    // Pages beyond the budget are left to be fetched as they are counted.
+    const HierarchyReader tiny(a.getEndpoint(out), m.nodeStats(), 1);
+    tiny.prefetch(keys);
+    EXPECT_LT(tiny.fetches(), total);
+
+    for (const Dxyz& k : keys) EXPECT_EQ(tiny.count(k), r.hierarchy().count(k));
+}
@@ -0,0 +1,299 @@
+#include "gtest/gtest.h"
+
+#include <fstream>
+#include <map>
+
+#include <pdal/PointTable.hpp>
+#include <pdal/PointView.hpp>
+#include <pdal/io/LasReader.hpp>
+
+#include "config.hpp"
+#include "verify.hpp"
+
+#include <entwine/builder/builder.hpp>
+#include <entwine/reader/reader.hpp>
+#include <entwine/third/arbiter/arbiter.hpp>
+
+namespace
+{
+    const Verify v;
+
+    struct Cmp
+    {
+        bool operator()(const Point& a, const Point& b) const
+        {
+            return ltChained(a, b);
+        }
+    };
+    using Counts = std::map<Point, uint64_t, Cmp>;
+
+    struct Las
+    {
+        pdal::PointViewPtr view;
+        pdal::SpatialReference srs;
+    };
+
+    // Reads the LAZ file at _path_ through PDAL.
+    Las readLaz(const std::string& path, pdal::PointTable& table)
+    {
+        pdal::Options o;
+        o.add("filename", path);
+
+        pdal::LasReader reader;
+        reader.setOptions(o);
+        reader.prepare(table);
+
+        const pdal::PointViewSet views(reader.execute(table));
+        return Las { *views.begin(), reader.getSpatialReference() };
+    }
+
+    void write(const std::string& path, const char* data, std::size_t size)
+    {
+        std::ofstream f(path, std::ios::out | std::ios::binary);
+        f.write(data, size);
+    }
+
+    // Add the points of the LAZ file _data_, rounded to _scale_ and _offset_,
+    // to _counts_, and return their number.
+    uint64_t count(
+            const char* data,
+            std::size_t size,
+            const Scale& scale,
+            const Offset& offset,
+            Counts& counts)
+    {
+        const std::string tmp(test::dataPath() + "out/ellipsoid/node.laz");
+        write(tmp, data, size);
+
+        pdal::PointTable table;
+        const pdal::PointViewPtr view(readLaz(tmp, table).view);
+
+        for (pdal::PointId i(0); i < view->size(); ++i)
+        {
+            const Point p(
+                    view->getFieldAs<double>(DimId::X, i),
+                    view->getFieldAs<double>(DimId::Y, i),
+                    view->getFieldAs<double>(DimId::Z, i));
+
+            ++counts[Point::scale(p, scale, offset).round()];
+        }
+
+        return view->size();
+    }
+
+    // The XYZ points of _data_, laid out as doubles, rounded likewise.
+    Counts count(
+            const std::vector<char>& data,
+            const Scale& scale,
+            const Offset& offset)
+    {
+        Counts counts;
+        const std::size_t size(sizeof(double));
+        for (std::size_t i(0); i < data.size(); i += 3 * size)
+        {
+            Point p;
+            const char* pos(data.data() + i);
+            std::copy(pos, pos + size, reinterpret_cast<char*>(&p.x));
+            pos += size;
+            std::copy(pos, pos + size, reinterpret_cast<char*>(&p.y));
+            pos += size;
+            std::copy(pos, pos + size, reinterpret_cast<char*>(&p.z));
+
+            ++counts[Point::scale(p, scale, offset).round()];
+        }
+        return counts;
+    }
+
+    Config config(const std::string& out)
+    {
+        Config c;
+        c["input"] = test::dataPath() + "ellipsoid.laz";
+        c["output"] = out;
+        c["force"] = true;
+        c["hierarchyStep"] = static_cast<Json::UInt64>(v.hierarchyStep());
+        c["ticks"] = static_cast<Json::UInt64>(v.ticks());
+        return c;
+    }
+}
+
+TEST(laszip, srs)
+{
+    const std::string out(test::dataPath() + "out/ellipsoid/ellipsoid-srs");
+    const Srs srs(std::string("EPSG:3857"));
+
+    {
+        Config c(config(out));
+        c["dataType"] = "laszip";
+        c["srs"] = "EPSG:3857";
+
+        Builder b(c);
+        b.go();
+    }
+
+    arbiter::Arbiter a;
+    const std::vector<std::string> paths(a.resolve(out + "/ept-data/*"));
+    ASSERT_FALSE(paths.empty());
+
+    uint64_t np(0);
+
+    for (const std::string& path : paths)
+    {
+        // Coordinate systems are stored as WKT, which requires LAS 1.4.
+        const std::vector<char> data(a.getBinary(path));
+        ASSERT_GT(data.size(), 25u);
+        EXPECT_EQ(data[24], 1);
+        EXPECT_EQ(data[25], 4);
+
+        pdal::PointTable table;
+        const Las las(readLaz(path, table));
+        EXPECT_EQ(las.srs.getWKT(), srs.wkt());
+
+        np += las.view->size();
+    }
+
+    EXPECT_EQ(np, v.points());
+}
+
+TEST(laszip, absolute)
+{
+    const std::string out(
+            test::dataPath() + "out/ellipsoid/ellipsoid-absolute");
+
+    arbiter::Arbiter a;
+
+    // Absolute coordinates can't be stored in a LAZ file without rounding
+    // them, so the build is rejected before anything is written.
+    {
+        Config c(config(out + "-laz"));
+        c["dataType"] = "laszip";
+        c["absolute"] = true;
+
+        EXPECT_THROW(Builder b(c), std::runtime_error);
+        EXPECT_FALSE(a.tryGetSize(out + "-laz/ept.json"));
+    }
+
+    {
+        Config c(config(out));
+        c["dataType"] = "binary";
+        c["absolute"] = true;
+
+        Builder b(c);
+        b.go();
+    }
+
+    Reader r(out);
+    const Metadata& m(r.metadata());
+    ASSERT_FALSE(m.outSchema().isScaled());
+
+    // Without a scaled schema, the points can't be encoded as LAZ either.
+    Json::Value j;
+    j["encoding"] = "laszip";
+    EXPECT_THROW(r.read(j), std::runtime_error);
+
+    // Given one, the points are those of the absolute build, rounded to it.
+    const Scale scale(0.01);
+    const Offset offset(m.boundsConforming().mid().round());
+
+    Schema scaled(DimList {
+        { DimId::X, DimType::Signed32, scale.x },
+        { DimId::Y, DimType::Signed32, scale.y },
+        { DimId::Z, DimType::Signed32, scale.z }
+    });
+    scaled.setOffset(offset);
+
+    const Schema xyz(DimList { DimId::X, DimId::Y, DimId::Z });
+
+    Json::Value bin;
+    bin["schema"] = xyz.toJson();
+    auto binary(r.read(bin));
+    binary->run();
+
+    const Counts expected(count(binary->data(), scale, offset));
+    ASSERT_EQ(binary->points(), v.points());
+
+    j["schema"] = scaled.toJson();
+    auto laz(r.read(j));
+
+    Counts counts;
+    laz->run([&](const char* pos, std::size_t size, std::size_t n)
+    {
+        EXPECT_EQ(count(pos, size, scale, offset, counts), n);
+    });
+
+    EXPECT_EQ(counts, expected);
+}
+
+TEST(laszip, encoding)
+{
+    const std::string out(
+            test::dataPath() + "out/ellipsoid/ellipsoid-laszip");
+
+    {
+        Config c(config(out));
+        c["dataType"] = "laszip";
+
+        Builder b(c);
+        b.go();
+    }
+
+    Reader r(out, "", std::make_shared<Cache>());
+    const Schema& outSchema(r.metadata().outSchema());
+    const Scale scale(outSchema.scale());
+    const Offset offset(outSchema.offset());
+
+    Json::Value bin;
+    bin["schema"] = Schema(DimList { DimId::X, DimId::Y, DimId::Z }).toJson();
+    auto binary(r.read(bin));
+    binary->run();
+    ASSERT_EQ(binary->points(), v.points());
+
+    const Counts expected(count(binary->data(), scale, offset));
+
+    // With no filter and the stored schema, every node is passed through as
+    // stored without decoding any chunks.
+    Json::Value j;
+    j["encoding"] = "laszip";
+
+    const auto misses(r.cache().stats().misses);
+
+    auto passed(r.read(j));
+    EXPECT_TRUE(passed->encoder().passthrough());
+
+    Counts counts;
+    uint64_t np(0);
+    std::size_t nodes(0);
+    passed->run([&](const char* pos, std::size_t size, std::size_t n)
+    {
+        ASSERT_GT(size, 4u);
+        EXPECT_EQ(std::string(pos, 4), "LASF");
+        EXPECT_EQ(count(pos, size, scale, offset, counts), n);
+
+        np += n;
+        ++nodes;
+    });
+
+    EXPECT_EQ(np, v.points());
+    EXPECT_GT(nodes, 0u);
+    EXPECT_EQ(r.cache().stats().misses, misses);
+    EXPECT_EQ(counts, expected);
+
+    // In another schema, the points are decoded and encoded anew.
+    Schema scaled(DimList {
+        { DimId::X, DimType::Signed32, scale.x },
+        { DimId::Y, DimType::Signed32, scale.y },
+        { DimId::Z, DimType::Signed32, scale.z }
+    });
+    scaled.setOffset(offset);
+    j["schema"] = scaled.toJson();
+
+    auto encoded(r.read(j));
+    EXPECT_FALSE(encoded->encoder().passthrough());
+
+    counts.clear();
+    encoded->run([&](const char* pos, std::size_t size, std::size_t n)
+    {
+        EXPECT_EQ(count(pos, size, scale, offset, counts), n);
+    });
+
+    EXPECT_EQ(counts, expected);
+}
@@ -0,0 +1,53 @@
+#include "gtest/gtest.h"
+
+#include "ellipsoid.hpp"
+
+TEST(levelOfDetail, refinement)
+{
+    const std::string out(test::buildEllipsoid("ellipsoid"));
+
+    Reader r(out);
+    const Metadata& m(r.metadata());
+    const Bounds& bounds(m.boundsCubic());
+
+    auto count([&r](const Json::Value& q)
+    {
+        auto query(r.count(q));
+        query->run();
+        return query->points();
+    });
+
+    // A resolution of the point spacing at some depth selects exactly the
+    // nodes down to that depth.
+    const double spacing(bounds.width() / m.ticks());
+    for (uint64_t d(0); d < 3; ++d)
+    {
+        Json::Value depth;
+        depth["depthEnd"] = static_cast<Json::UInt64>(d + 1);
+
+        Json::Value resolution;
+        resolution["resolution"] = spacing / (1 << d);
+        EXPECT_EQ(count(resolution), count(depth));
+
+        // Slightly sparser, to be robust to rounding.
+        const double r(resolution["resolution"].asDouble());
+        Json::Value density;
+        density["density"] = 0.99 / (r * r);
+        EXPECT_EQ(count(density), count(depth));
+    }
+
+    // A camera far away needs only coarse nodes.
+    auto camera([&](const Point& position)
+    {
+        Json::Value q;
+        q["camera"]["position"] = position.toJson();
+        q["camera"]["fov"] = 1.0;
+        q["camera"]["height"] = 1000;
+        return count(q);
+    });
+
+    const Point& mid(bounds.mid());
+    const Point far(mid.x, mid.y, mid.z + bounds.width() * 1000);
+    EXPECT_GT(camera(far), 0u);
+    EXPECT_LT(camera(far), camera(mid));
+}
@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+
+#include "config.hpp"
+#include "verify.hpp"
+
+#include <istream>
+#include <iterator>
+#include <vector>
+
+#include <entwine/io/laszip.hpp>
+#include <entwine/io/range-buffer.hpp>
+#include <entwine/types/vector-point-table.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const Verify v;
+    const std::string filename("ellipsoid.laz");
+}
+
+TEST(range, seek)
+{
+    const arbiter::Arbiter a;
+    const arbiter::Endpoint ep(a.getEndpoint(test::dataPath()));
+    const std::vector<char> full(ep.getBinary(filename));
+
+    // Use a block size which doesn't divide the file evenly.
+    RangeBuffer buffer(ep, filename, full.size(), 1000);
+    std::istream is(&buffer);
+
+    const std::vector<char> streamed(
+            (std::istreambuf_iterator<char>(is)),
+            std::istreambuf_iterator<char>());
+    ASSERT_EQ(streamed, full);
+
+    for (const uint64_t pos : { 0ul, 999ul, 1000ul, 5555ul, 123ul })
+    {
+        is.clear();
+        is.seekg(pos);
+
+        std::vector<char> data(1500);
+        is.read(data.data(), data.size());
+        ASSERT_EQ(static_cast<uint64_t>(is.gcount()), data.size());
+        EXPECT_TRUE(std::equal(data.begin(), data.end(), full.begin() + pos));
+    }
+
+    is.clear();
+    is.seekg(-10, std::ios_base::end);
+    std::vector<char> tail(20);
+    is.read(tail.data(), tail.size());
+    EXPECT_EQ(is.gcount(), 10);
+}
+
+#ifdef ENTWINE_HAVE_LASZIP
+TEST(range, laszip)
+{
+    const arbiter::Arbiter a;
+    const arbiter::Endpoint ep(a.getEndpoint(test::dataPath()));
+    const uint64_t size(ep.getSize(filename));
+
+    RangeBuffer buffer(ep, filename, size, 4096);
+    std::istream is(&buffer);
+
+    LaszipReader reader(is, filename);
+    ASSERT_EQ(reader.points(), v.points());
+
+    const Schema schema(v.schema());
+    reader.select([&schema](const std::string& name)
+    {
+        return schema.contains(name) ? schema.find(name).id() : DimId::Unknown;
+    });
+
+    VectorPointTable table(schema, 1);
+    pdal::PointRef pr(table, 0);
+
+    Bounds bounds(Bounds::expander());
+    for (uint64_t i(0); i < reader.points(); ++i)
+    {
+        reader.read(pr);
+        bounds.grow(
+                Point(
+                    pr.getFieldAs<double>(DimId::X),
+                    pr.getFieldAs<double>(DimId::Y),
+                    pr.getFieldAs<double>(DimId::Z)));
+    }
+
+    EXPECT_TRUE(v.bounds().contains(bounds.mid()));
+}
+#endif
@@ -1,10 +1,8 @@
 #include "gtest/gtest.h"
 
-#include "config.hpp"
-#include "verify.hpp"
+#include <map>
 
-#include <entwine/builder/builder.hpp>
-#include <entwine/reader/reader.hpp>
+#include "ellipsoid.hpp"
 
 namespace
 {
@@ -13,19 +11,7 @@ namespace
 
 TEST(read, count)
 {
-    const std::string out(test::dataPath() + "out/ellipsoid/ellipsoid");
-
-    {
-        Config c;
-        c["input"] = test::dataPath() + "ellipsoid.laz";
-        c["output"] = out;
-        c["force"] = true;
-        c["hierarchyStep"] = static_cast<Json::UInt64>(v.hierarchyStep());
-        c["ticks"] = static_cast<Json::UInt64>(v.ticks());
-
-        Builder b(c);
-        b.go();
-    }
+    const std::string out(test::buildEllipsoid("ellipsoid"));
 
     Reader r(out);
     const Metadata& m(r.metadata());
@@ -47,19 +33,7 @@ TEST(read, count)
 
 TEST(read, data)
 {
-    const std::string out(test::dataPath() + "out/ellipsoid/ellipsoid");
-
-    {
-        Config c;
-        c["input"] = test::dataPath() + "ellipsoid.laz";
-        c["output"] = out;
-        c["force"] = true;
-        c["hierarchyStep"] = static_cast<Json::UInt64>(v.hierarchyStep());
-        c["ticks"] = static_cast<Json::UInt64>(v.ticks());
-
-        Builder b(c);
-        b.go();
-    }
+    const std::string out(test::buildEllipsoid("ellipsoid"));
 
     Reader r(out);
     const Metadata& m(r.metadata());
@@ -120,7 +94,227 @@ TEST(read, data)
     ASSERT_EQ(counts.size(), v.points());
 }
 
-TEST(read, filter)
+TEST(read, prefetch)
+{
+    const std::string out(test::buildEllipsoid("ellipsoid"));
+
+    Reader r(out);
+    const Schema schema(DimList { DimId::X, DimId::Y, DimId::Z });
+
+    Json::Value j;
+    j["schema"] = schema.toJson();
+    j["prefetch"] = 1;
+
+    auto serial(r.read(j));
+    serial->run();
+    ASSERT_EQ(serial->data().size(), v.points() * schema.pointSize());
+
+    // Chunks are processed in node order regardless of how many are fetched
+    // concurrently, so the results are identical.
+    j["prefetch"] = 64;
+
+    auto parallel(r.read(j));
+    parallel->run();
+    EXPECT_EQ(parallel->data(), serial->data());
+
+    // Readers share one pool unless they are given their own.
+    Reader other(out);
+    EXPECT_EQ(&other.pool(), &r.pool());
+
+    auto pool(std::make_shared<Pool>(2, 64, false));
+    Reader own(out, "", nullptr, nullptr, nullptr, pool);
+    EXPECT_EQ(&own.pool(), pool.get());
+
+    auto owned(own.read(j));
+    owned->run();
+    EXPECT_EQ(owned->data(), serial->data());
+}
+
+TEST(read, failure)
+{
+    Json::Value options;
+    options["dataType"] = "laszip";
+    const std::string out(test::buildEllipsoid("ellipsoid-failure", options));
+
+    // Corrupt a node beneath the root, which is fetched while others are
+    // still in flight.
+    arbiter::Arbiter a;
+    const arbiter::Endpoint ep(a.getEndpoint(out + "/ept-data"));
+
+    std::string path;
+    for (const std::string& p : a.resolve(out + "/ept-data/*"))
+    {
+        const std::string name(arbiter::util::getBasename(p));
+        if (name != "0-0-0-0.laz") path = name;
+    }
+    ASSERT_FALSE(path.empty());
+
+    const std::vector<char> stored(ep.getBinary(path));
+    ep.put(path, std::string("corrupt"));
+
+    {
+        Reader r(out, "", std::make_shared<Cache>());
+
+        Json::Value j;
+        j["prefetch"] = 64;
+
+        // The failure propagates once the tasks fetching other nodes, which
+        // reference the query, have completed, so it may then be destroyed.
+        auto q(r.read(j));
+        EXPECT_THROW(q->run(), std::runtime_error);
+        q.reset();
+
+        // Counting every point reads no nodes, so is unaffected.
+        auto c(r.count(Json::Value()));
+        c->run();
+        EXPECT_EQ(c->points(), v.points());
+    }
+
+    ep.put(path, stored);
+
+    Reader r(out, "", std::make_shared<Cache>());
+    auto q(r.read(Json::Value()));
+    q->run();
+    EXPECT_EQ(q->points(), v.points());
+}
+
+TEST(read, stream)
 {
+    const std::string out(test::buildEllipsoid("ellipsoid"));
+
+    Reader r(out);
+    const Schema schema(DimList { DimId::X, DimId::Y, DimId::Z });
+
+    Json::Value j;
+    j["schema"] = schema.toJson();
+
+    auto whole(r.read(j));
+    whole->run();
+    ASSERT_EQ(whole->data().size(), v.points() * schema.pointSize());
+
+    const std::size_t batchSize(1000);
+    std::vector<char> streamed;
+    std::size_t batches(0);
+
+    auto q(r.read(j));
+    q->run([&](const char* data, std::size_t size, std::size_t n)
+    {
+        ASSERT_LE(n, batchSize);
+        ASSERT_EQ(size, n * schema.pointSize());
+
+        // Without depths being reported, only the final batch may be
+        // partial.
+        if (n < batchSize)
+        {
+            EXPECT_EQ(
+                    streamed.size() + n * schema.pointSize(),
+                    whole->data().size());
+        }
+
+        streamed.insert(streamed.end(), data, data + size);
+        ++batches;
+    }, batchSize);
+
+    EXPECT_EQ(q->points(), v.points());
+    EXPECT_EQ(batches, (v.points() + batchSize - 1) / batchSize);
+    EXPECT_EQ(streamed, whole->data());
+    EXPECT_LE(q->data().capacity(), batchSize * schema.pointSize());
+
+    // Reporting depths, the batch is flushed as each one completes, so the
+    // points of every reported depth have been received when it is.
+    std::vector<uint64_t> through;
+    std::vector<uint64_t> received;
+    uint64_t np(0);
+    for (uint64_t d(0); np < v.points(); ++d)
+    {
+        Json::Value depth;
+        depth["depthBegin"] = static_cast<Json::UInt64>(d);
+        depth["depthEnd"] = static_cast<Json::UInt64>(d + 1);
+
+        auto c(r.count(depth));
+        c->run();
+        np += c->points();
+        through.push_back(np);
+    }
+
+    streamed.clear();
+    auto progressive(r.read(j));
+    progressive->onDepth([&](uint64_t d)
+    {
+        received.push_back(streamed.size() / schema.pointSize());
+    });
+    progressive->run([&](const char* data, std::size_t size, std::size_t n)
+    {
+        ASSERT_LE(n, batchSize);
+        streamed.insert(streamed.end(), data, data + size);
+    }, batchSize);
+
+    EXPECT_EQ(received, through);
+    EXPECT_EQ(streamed, whole->data());
 }
 
+TEST(read, progressive)
+{
+    const std::string out(test::buildEllipsoid("ellipsoid"));
+
+    Reader r(out);
+
+    // Each depth is reported in order, and a query which runs to completion
+    // satisfies every depth.
+    {
+        std::vector<uint64_t> depths;
+        auto q(r.count(Json::Value()));
+        q->onDepth([&depths](uint64_t d) { depths.push_back(d); });
+        q->run();
+
+        EXPECT_TRUE(q->done());
+        EXPECT_EQ(q->points(), v.points());
+        ASSERT_FALSE(depths.empty());
+        for (std::size_t i(0); i < depths.size(); ++i)
+        {
+            EXPECT_EQ(depths[i], i);
+        }
+        EXPECT_EQ(q->satisfied(), depths.size());
+    }
+
+    // Cancelled once the shallowest depths are complete, the result holds at
+    // least their points, but not all of them.
+    {
+        Json::Value j;
+        j["prefetch"] = 1;
+
+        std::vector<uint64_t> depths;
+        auto q(r.read(j));
+        ReadQuery& query(*q);
+        q->onDepth([&depths, &query](uint64_t d)
+        {
+            depths.push_back(d);
+            if (d == 1) query.cancel();
+        });
+        q->run();
+
+        Json::Value shallow;
+        shallow["depthEnd"] = 2;
+        auto c(r.count(shallow));
+        c->run();
+
+        EXPECT_FALSE(q->done());
+        EXPECT_GE(q->satisfied(), 2u);
+        EXPECT_EQ(q->satisfied(), depths.size());
+        EXPECT_GE(q->points(), c->points());
+        EXPECT_LT(q->points(), v.points());
+        EXPECT_EQ(q->data().size(), q->points() * q->schema().pointSize());
+    }
+
+    // A deadline which has passed before anything is read.
+    {
+        Json::Value j;
+        j["deadline"] = 1e-6;
+
+        auto q(r.count(j));
+        q->run();
+        EXPECT_FALSE(q->done());
+        EXPECT_EQ(q->satisfied(), 0u);
+        EXPECT_EQ(q->points(), 0u);
+    }
+}
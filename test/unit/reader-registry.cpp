@@ -0,0 +1,51 @@
+#include "gtest/gtest.h"
+
+#include "ellipsoid.hpp"
+
+#include <entwine/reader/reader-registry.hpp>
+
+namespace
+{
+    const Verify v;
+}
+
+TEST(readerRegistry, idle)
+{
+    const std::string out(test::buildEllipsoid("ellipsoid"));
+
+    // Idle readers are closed as soon as another reader is requested.
+    ReaderRegistry registry(1024 * 1024 * 64, 0);
+
+    uint64_t id(0);
+    {
+        auto a(registry.get(out));
+        auto b(registry.get(out));
+        EXPECT_EQ(a, b);
+        EXPECT_EQ(&a->cache(), &registry.cache());
+        EXPECT_EQ(&a->pool(), &registry.pool());
+        EXPECT_EQ(registry.size(), 1u);
+        EXPECT_EQ(registry.idle(), 0u);
+
+        auto q(a->count(Json::Value()));
+        q->run();
+        EXPECT_EQ(q->points(), v.points());
+        EXPECT_GT(registry.cache().size(), 0u);
+        EXPECT_GT(registry.hierarchyCache().size(), 0u);
+
+        id = a->id();
+    }
+
+    EXPECT_EQ(registry.idle(), 1u);
+
+    // The idle reader was closed, along with its cached data, so this one
+    // is opened anew.
+    auto c(registry.get(out));
+    EXPECT_NE(c->id(), id);
+    EXPECT_EQ(registry.size(), 1u);
+    EXPECT_EQ(registry.cache().size(), 0u);
+    EXPECT_EQ(registry.hierarchyCache().size(), 0u);
+
+    auto q(c->count(Json::Value()));
+    q->run();
+    EXPECT_EQ(q->points(), v.points());
+}
@@ -0,0 +1,224 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <entwine/io/scheduler.hpp>
+
+using namespace entwine;
+
+TEST(scheduler, concurrency)
+{
+    IoScheduler& s(IoScheduler::instance());
+    const std::size_t previous(s.concurrency());
+    s.setConcurrency(2);
+
+    std::atomic_size_t active(0);
+    std::atomic_size_t peak(0);
+
+    std::vector<std::thread> threads;
+    for (std::size_t i(0); i < 8; ++i)
+    {
+        threads.emplace_back([&s, &active, &peak]()
+        {
+            s.run("test-concurrency/", IoMethod::Get, "a", [&](uint64_t& b)
+            {
+                const std::size_t now(++active);
+                std::size_t p(peak);
+                while (now > p && !peak.compare_exchange_weak(p, now)) { }
+
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                --active;
+                b = 1;
+                return true;
+            });
+        });
+    }
+
+    for (auto& t : threads) t.join();
+    s.setConcurrency(previous);
+
+    EXPECT_LE(peak, 2u);
+
+    const Json::Value stats(s.toJson()["test-concurrency/"]);
+    EXPECT_EQ(stats["requests"].asUInt64(), 8u);
+    EXPECT_EQ(stats["bytesRead"].asUInt64(), 8u);
+}
+
+TEST(scheduler, retry)
+{
+    IoScheduler& s(IoScheduler::instance());
+
+    std::size_t attempts(0);
+    s.run("test-retry/", IoMethod::Put, "a", [&](uint64_t& b)
+    {
+        if (++attempts == 1) throw std::runtime_error("Transient");
+        b = 4;
+        return true;
+    });
+
+    EXPECT_EQ(attempts, 2u);
+
+    const Json::Value stats(s.toJson()["test-retry/"]);
+    EXPECT_EQ(stats["failures"].asUInt64(), 1u);
+    EXPECT_EQ(stats["bytesWritten"].asUInt64(), 4u);
+}
+
+TEST(scheduler, coalesce)
+{
+    IoScheduler& s(IoScheduler::instance());
+
+    std::atomic_size_t fetches(0);
+    std::vector<std::vector<char>> results(4);
+
+    std::vector<std::thread> threads;
+    for (std::size_t i(0); i < results.size(); ++i)
+    {
+        threads.emplace_back([&s, &fetches, &results, i]()
+        {
+            results[i] = s.coalesce("test-coalesce/", "key", "", [&fetches]()
+            {
+                ++fetches;
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                return std::vector<char> { 'a', 'b', 'c' };
+            });
+        });
+    }
+
+    for (auto& t : threads) t.join();
+
+    EXPECT_GE(fetches, 1u);
+    EXPECT_LT(fetches, results.size());
+
+    for (const auto& r : results)
+    {
+        EXPECT_EQ(r, (std::vector<char> { 'a', 'b', 'c' }));
+    }
+}
+
+TEST(scheduler, backoff)
+{
+    IoScheduler& s(IoScheduler::instance());
+    const std::size_t previous(s.concurrency());
+    s.setConcurrency(1);
+
+    std::atomic_size_t attempts(0);
+    auto failing(s.submit("test-backoff/", IoMethod::Put, "a", [&](uint64_t&)
+    {
+        return ++attempts > 1;
+    }));
+
+    while (!attempts) std::this_thread::yield();
+
+    // While the failed request waits to be retried, it holds neither the
+    // only slot nor the thread which attempted it.
+    s.run("test-backoff/", IoMethod::Get, "b", [](uint64_t&) { return true; });
+
+    EXPECT_EQ(attempts, 1u);
+    EXPECT_EQ(
+            failing.wait_for(std::chrono::seconds(0)),
+            std::future_status::timeout);
+
+    failing.get();
+    EXPECT_EQ(attempts, 2u);
+
+    s.setConcurrency(previous);
+}
+
+TEST(scheduler, putsNotStarved)
+{
+    IoScheduler& s(IoScheduler::instance());
+    const std::size_t previous(s.concurrency());
+    s.setConcurrency(1);
+
+    std::atomic_bool stop(false);
+
+    std::vector<std::thread> readers;
+    for (std::size_t i(0); i < 4; ++i)
+    {
+        readers.emplace_back([&s, &stop]()
+        {
+            while (!stop)
+            {
+                s.run("test-starve/", IoMethod::Get, "a", [](uint64_t&)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                    return true;
+                });
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    // Some GET is always queued, but the PUT is served regardless.
+    auto put(s.submit("test-starve/", IoMethod::Put, "b", [](uint64_t&)
+    {
+        return true;
+    }));
+
+    EXPECT_EQ(
+            put.wait_for(std::chrono::seconds(10)),
+            std::future_status::ready);
+
+    stop = true;
+    for (auto& t : readers) t.join();
+    put.get();
+
+    s.setConcurrency(previous);
+}
+
+TEST(scheduler, coalesceAcrossPut)
+{
+    IoScheduler& s(IoScheduler::instance());
+
+    std::atomic_size_t fetches(0);
+    std::atomic_bool released(false);
+
+    std::vector<char> first;
+    std::thread leader([&]()
+    {
+        first = s.coalesce("test-stale/", "key", "", [&]()
+        {
+            ++fetches;
+            while (!released) std::this_thread::yield();
+            return std::vector<char> { 'a' };
+        });
+    });
+
+    while (!fetches) std::this_thread::yield();
+
+    // Once a PUT to this path is queued, the GET in flight may be stale, so
+    // a later GET is performed anew rather than sharing its result.
+    auto put(s.submit("test-stale/", IoMethod::Put, "key", [&](uint64_t&)
+    {
+        while (!released) std::this_thread::yield();
+        return true;
+    }));
+
+    const std::vector<char> second(
+            s.coalesce("test-stale/", "key", "", [&]()
+            {
+                ++fetches;
+                return std::vector<char> { 'b' };
+            }));
+
+    released = true;
+    leader.join();
+    put.get();
+
+    EXPECT_EQ(fetches, 2u);
+    EXPECT_EQ(first, std::vector<char> { 'a' });
+    EXPECT_EQ(second, std::vector<char> { 'b' });
+
+    // Nothing is left in flight to hold up later GETs.
+    const std::vector<char> third(
+            s.coalesce("test-stale/", "key", "", []()
+            {
+                return std::vector<char> { 'c' };
+            }));
+    EXPECT_EQ(third, std::vector<char> { 'c' });
+}